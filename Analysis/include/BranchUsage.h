@@ -0,0 +1,97 @@
+/*! Recording of the event branches used by the analysis code and the branch manifest files.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <set>
+#include "AnalysisTools/Core/include/exception.h"
+#include "EventTuple.h"
+
+namespace ntuple {
+
+// Collects names of the ntuple::Event branches accessed through ntuple::EventAccessor (used by the tuple-level objects
+// and EventInfoBase) while the recorder is active. Branches that are read from ntuple::Event directly, e.g. by the
+// weight providers, are not seen by the recorder and should be added explicitly. The resulting manifest can be used
+// to enable only the required branches in the production run, see EventTupleOptions::enabled_branches. Accessed
+// branches are recorded by their index (see EventBranchUsage) and converted to names only when they are requested.
+class BranchUsageRecorder : public EventBranchUsage {
+public:
+    BranchUsageRecorder() : branches(EssentialBranches())
+    {
+        EventBranchUsage* expected = nullptr;
+        if(!Active().compare_exchange_strong(expected, this))
+            throw analysis::exception("Only one branch usage recorder can be active at the same time.");
+    }
+
+    ~BranchUsageRecorder() { Active().store(nullptr); }
+
+    void Add(const std::string& branch_name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        branches.insert(branch_name);
+    }
+
+    void Add(const std::set<std::string>& branch_names)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        branches.insert(branch_names.begin(), branch_names.end());
+    }
+
+    std::set<std::string> GetBranches() const
+    {
+        const EventBranchMask used = GetUsedBranches();
+        std::lock_guard<std::mutex> lock(mutex);
+        std::set<std::string> result = branches;
+        for(size_t n = 0; n < used.size(); ++n) {
+            if(used[n])
+                result.insert(EventBranchNames().at(n));
+        }
+        return result;
+    }
+
+    void WriteManifest(const std::string& file_name) const
+    {
+        std::ofstream file(file_name);
+        if(!file.is_open())
+            throw analysis::exception("Unable to create branch manifest file '%1%'.") % file_name;
+        file << "# Event branches used by the analysis code.\n";
+        for(const auto& branch_name : GetBranches())
+            file << branch_name << "\n";
+        if(!file.good())
+            throw analysis::exception("Error while writing branch manifest file '%1%'.") % file_name;
+    }
+
+    // Branches required to identify and load an event, even if they are never accessed by the analysis code.
+    static const std::set<std::string>& EssentialBranches()
+    {
+        static const std::set<std::string> essential = {
+            "run", "lumi", "evt", "eventEnergyScale", "storageMode", "storageMask"
+        };
+        return essential;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::set<std::string> branches;
+};
+
+// Reads the branch manifest: one branch name per line, empty lines and lines starting with '#' are ignored.
+inline std::set<std::string> ReadBranchManifest(const std::string& file_name)
+{
+    std::ifstream file(file_name);
+    if(!file.is_open())
+        throw analysis::exception("Unable to open branch manifest file '%1%'.") % file_name;
+    std::set<std::string> branches = BranchUsageRecorder::EssentialBranches();
+    std::string line;
+    while(std::getline(file, line)) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if(first == std::string::npos || line.at(first) == '#') continue;
+        const size_t last = line.find_last_not_of(" \t\r");
+        branches.insert(line.substr(first, last - first + 1));
+    }
+    return branches;
+}
+
+} // namespace ntuple
@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <array>
 #include "AnalysisTools/Core/include/AnalysisMath.h"
 
 namespace analysis {
@@ -97,35 +98,35 @@ class CompositCandidate : public AnalysisObject {
 public:
     using FirstDaughter = _FirstDaughter;
     using SecondDaughter = _SecondDaughter;
+    using DaughterMomentums = std::array<LorentzVector, 2>;
+
     CompositCandidate(const FirstDaughter& _firstDaughter, const SecondDaughter& _secondDaughter)
         : AnalysisObject(_firstDaughter.GetMomentum() + _secondDaughter.GetMomentum()),
-          firstDaughter(_firstDaughter), secondDaughter(_secondDaughter)
+          firstDaughter(_firstDaughter), secondDaughter(_secondDaughter),
+          daughterMomentums{{ firstDaughter.GetMomentum(), secondDaughter.GetMomentum() }}
     {
         if(firstDaughter.HasCharge() && secondDaughter.HasCharge())
             this->SetCharge(firstDaughter.GetCharge() + secondDaughter.GetCharge());
-        daughterMomentums.push_back(firstDaughter.GetMomentum());
-        daughterMomentums.push_back(secondDaughter.GetMomentum());
     }
 
     template<typename FourVector>
     CompositCandidate(const FirstDaughter& _firstDaughter, const SecondDaughter& _secondDaughter,
                       const FourVector& _momentum)
-        : AnalysisObject(_momentum), firstDaughter(_firstDaughter), secondDaughter(_secondDaughter)
+        : AnalysisObject(_momentum), firstDaughter(_firstDaughter), secondDaughter(_secondDaughter),
+          daughterMomentums{{ firstDaughter.GetMomentum(), secondDaughter.GetMomentum() }}
     {
         if(firstDaughter.HasCharge() && secondDaughter.HasCharge())
             this->SetCharge(firstDaughter.GetCharge() + secondDaughter.GetCharge());
-        daughterMomentums.push_back(firstDaughter.GetMomentum());
-        daughterMomentums.push_back(secondDaughter.GetMomentum());
     }
 
     const FirstDaughter& GetFirstDaughter() const { return firstDaughter; }
     const SecondDaughter& GetSecondDaughter() const { return secondDaughter; }
-    const std::vector<LorentzVector>& GetDaughterMomentums() const { return daughterMomentums; }
+    const DaughterMomentums& GetDaughterMomentums() const { return daughterMomentums; }
 
 private:
     FirstDaughter firstDaughter;
     SecondDaughter secondDaughter;
-    std::vector<LorentzVector> daughterMomentums;
+    DaughterMomentums daughterMomentums;
 };
 
 template<typename MetObject>
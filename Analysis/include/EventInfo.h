@@ -3,8 +3,8 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
-#include <list>
 #include <algorithm>
+#include <boost/optional.hpp>
 #include "EventTuple.h"
 #include "AnalysisTypes.h"
 #include "RootExt.h"
@@ -106,29 +106,43 @@ private:
 class EventInfoBase {
 public:
     using Event = ntuple::Event;
+    using EventAccessor = ntuple::EventAccessor;
     using JetPair = ntuple::JetPair;
     using JetCollection = std::vector<JetCandidate>;
     using FatJetCollection = std::vector<FatJetCandidate>;
     using HiggsBBCandidate = CompositCandidate<JetCandidate, JetCandidate>;
 
-    static JetPair SelectBjetPair(const Event& event, double pt_cut = std::numeric_limits<double>::lowest(),
-                                   double eta_cut = std::numeric_limits<double>::lowest(),
-                                   JetOrdering jet_ordering = JetOrdering::CSV)
+    static void SelectJetIndexes(const ntuple::TupleJetView& jetView, std::vector<size_t>& indexes,
+                                 double pt_cut = std::numeric_limits<double>::lowest(),
+                                 double eta_cut = std::numeric_limits<double>::lowest(),
+                                 double csv_cut = std::numeric_limits<double>::lowest(),
+                                 JetOrdering jet_ordering = JetOrdering::CSV)
     {
-        const auto orderer = [&](size_t j1, size_t j2) -> bool {
-            if(jet_ordering == JetOrdering::Pt)
-                return event.jets_p4.at(j1).Pt() > event.jets_p4.at(j2).Pt();
-            if(jet_ordering == JetOrdering::CSV)
-                return event.jets_csv.at(j1) > event.jets_csv.at(j2);
-            throw exception("Unsupported jet ordering for b-jet pair selection.");
-        };
+        const auto& pt = jetView.pt();
+        const auto& eta = jetView.eta();
+        const auto& csv = jetView.csv();
 
-        std::vector<size_t> indexes;
-        for(size_t n = 0; n < event.jets_p4.size(); ++n) {
-            if(event.jets_p4.at(n).Pt() > pt_cut && std::abs(event.jets_p4.at(n).eta()) < eta_cut)
+        indexes.clear();
+        for(size_t n = 0; n < jetView.size(); ++n) {
+            if(pt[n] > pt_cut && std::abs(eta[n]) < eta_cut && csv[n] > csv_cut)
                 indexes.push_back(n);
         }
-        std::sort(indexes.begin(), indexes.end(), orderer);
+
+        if(jet_ordering == JetOrdering::Pt)
+            std::sort(indexes.begin(), indexes.end(), [&](size_t j1, size_t j2) { return pt[j1] > pt[j2]; });
+        else if(jet_ordering != JetOrdering::NoOrdering)
+            std::sort(indexes.begin(), indexes.end(), [&](size_t j1, size_t j2) { return csv[j1] > csv[j2]; });
+    }
+
+    static JetPair SelectBjetPair(const ntuple::TupleJetView& jetView, std::vector<size_t>& indexes,
+                                  double pt_cut = std::numeric_limits<double>::lowest(),
+                                  double eta_cut = std::numeric_limits<double>::lowest(),
+                                  JetOrdering jet_ordering = JetOrdering::CSV)
+    {
+        if(jet_ordering != JetOrdering::Pt && jet_ordering != JetOrdering::CSV)
+            throw exception("Unsupported jet ordering for b-jet pair selection.");
+
+        SelectJetIndexes(jetView, indexes, pt_cut, eta_cut, std::numeric_limits<double>::lowest(), jet_ordering);
         JetPair selected_pair = ntuple::UndefinedJetPair();
         if(indexes.size() >= 1)
             selected_pair.first = indexes.at(0);
@@ -137,25 +151,70 @@ public:
         return selected_pair;
     }
 
+    static JetPair SelectBjetPair(const EventAccessor& event, double pt_cut = std::numeric_limits<double>::lowest(),
+                                   double eta_cut = std::numeric_limits<double>::lowest(),
+                                   JetOrdering jet_ordering = JetOrdering::CSV)
+    {
+        static thread_local ntuple::TupleJetView jetView;
+        static thread_local std::vector<size_t> indexes;
+        jetView.Reset(event);
+        return SelectBjetPair(jetView, indexes, pt_cut, eta_cut, jet_ordering);
+    }
+
     static constexpr int verbosity = 0;
 
-    EventInfoBase(const Event& _event, const JetPair& _selected_bjet_pair = JetPair(0, 1),
+    EventInfoBase(const EventAccessor& _event, const JetPair& _selected_bjet_pair = JetPair(0, 1),
                   const SummaryInfo* _summaryInfo = nullptr) :
-        event(&_event), summaryInfo(_summaryInfo), eventIdentifier(_event.run, _event.lumi, _event.evt),
+        event(_event), summaryInfo(_summaryInfo), eventIdentifier(_event.run(), _event.lumi(), _event.evt()),
         selected_bjet_pair(_selected_bjet_pair),
-        has_bjet_pair(selected_bjet_pair.first < GetNJets() && selected_bjet_pair.second < GetNJets())
+        has_bjet_pair(selected_bjet_pair.first < GetNJets() && selected_bjet_pair.second < GetNJets()),
+        has_jet_view(false), has_jets(false), has_fatJets(false), mva_score(0)
     {
-        triggerResults.SetAcceptBits(event->trigger_accepts);
-        triggerResults.SetMatchBits(event->trigger_matches);
+        triggerResults.SetAcceptBits(event.trigger_accepts());
+        triggerResults.SetMatchBits(event.trigger_matches());
     }
 
+    EventInfoBase(const EventInfoBase&) = delete;
+    EventInfoBase& operator=(const EventInfoBase&) = delete;
     virtual ~EventInfoBase() {}
 
-    const Event& operator*() const { return *event; }
-    const Event* operator->() const { return event; }
+    // Re-initializes the object for a new event. The storage of the lazily created objects is reused,
+    // so no memory allocations are made in steady state.
+    virtual void Reset(const EventAccessor& _event, const JetPair& _selected_bjet_pair = JetPair(0, 1))
+    {
+        event = _event;
+        eventIdentifier = EventIdentifier(_event.run(), _event.lumi(), _event.evt());
+        selected_bjet_pair = _selected_bjet_pair;
+        has_bjet_pair = selected_bjet_pair.first < GetNJets() && selected_bjet_pair.second < GetNJets();
+        triggerResults.SetAcceptBits(event.trigger_accepts());
+        triggerResults.SetMatchBits(event.trigger_matches());
+
+        has_jet_view = false;
+        has_jets = false;
+        jets.clear();
+        tuple_jets.clear();
+        has_fatJets = false;
+        fatJets.clear();
+        tuple_fatJets.clear();
+        higgs_bb = boost::none;
+        met = boost::none;
+        tuple_met = boost::none;
+        kinfit_results = boost::none;
+        mt2 = boost::none;
+        mva_score = 0;
+    }
+
+    // Direct access to the stored event is allowed only if all branches are stored within it. Branches of partially
+    // stored events should be read through GetEventAccessor, or the event should be loaded with EventLoader::Load.
+    const Event& operator*() const { return GetFullEvent(); }
+    const Event* operator->() const { return &GetFullEvent(); }
+    const EventAccessor& GetEventAccessor() const { return event; }
 
     const EventIdentifier& GetEventId() const { return eventIdentifier; }
-    EventEnergyScale GetEnergyScale() const { return static_cast<EventEnergyScale>(event->eventEnergyScale); }
+    EventEnergyScale GetEnergyScale() const
+    {
+        return static_cast<EventEnergyScale>(event.eventEnergyScale());
+    }
     const TriggerResults& GetTriggerResults() const { return triggerResults; }
     const SummaryInfo& GetSummaryInfo() const
     {
@@ -167,55 +226,73 @@ public:
     virtual const AnalysisObject& GetLeg(size_t /*leg_id*/) { throw exception("Method not supported."); }
     virtual LorentzVector GetHiggsTTMomentum(bool /*useSVfit*/) { throw exception("Method not supported."); }
 
-    size_t GetNJets() const { return event->jets_p4.size(); }
-    size_t GetNFatJets() const { return event->fatJets_p4.size(); }
+    size_t GetNJets() const { return event.jets_p4().size(); }
+    size_t GetNFatJets() const { return event.fatJets_p4().size(); }
+
+    // Tuple jets are created only for the jets that are actually used, and are kept until the next Reset, since jet
+    // candidates refer to them.
+    const ntuple::TupleJet& GetTupleJet(size_t index)
+    {
+        if(tuple_jets.empty())
+            tuple_jets.resize(GetNJets());
+        if(index >= tuple_jets.size())
+            throw exception("Jet id = %1% is out of range.") % index;
+        boost::optional<ntuple::TupleJet>& tuple_jet = tuple_jets[index];
+        if(!tuple_jet)
+            tuple_jet.emplace(event, index);
+        return *tuple_jet;
+    }
 
     const JetCollection& GetJets()
     {
-        if(!jets) {
-            jets = std::shared_ptr<JetCollection>(new JetCollection());
-            for(size_t n = 0; n < GetNJets(); ++n) {
-                tuple_jets.push_back(ntuple::TupleJet(*event, n));
-                jets->push_back(JetCandidate(tuple_jets.back()));
-            }
+        if(!has_jets) {
+            for(size_t n = 0; n < GetNJets(); ++n)
+                jets.push_back(JetCandidate(GetTupleJet(n)));
+            has_jets = true;
         }
-        return *jets;
+        return jets;
     }
 
-    JetCollection SelectJets(double pt_cut = std::numeric_limits<double>::lowest(),
-                             double eta_cut = std::numeric_limits<double>::lowest(),
-                             double csv_cut = std::numeric_limits<double>::lowest(),
-                             JetOrdering jet_ordering = JetOrdering::CSV)
+    const ntuple::TupleJetView& GetJetView()
     {
-        const auto orderer = [&](const JetCandidate& j1, const JetCandidate& j2) -> bool {
-            if(jet_ordering == JetOrdering::Pt)
-                return j1.GetMomentum().Pt() > j2.GetMomentum().Pt();
-            return j1->csv() > j2->csv();
-        };
-
-        const JetCollection& all_jets = GetJets();
-        JetCollection selected_jets;
-        for(const JetCandidate& jet : all_jets) {
-            if(jet.GetMomentum().Pt() > pt_cut && std::abs(jet.GetMomentum().eta()) < eta_cut
-                    && jet->csv() > csv_cut)
-                selected_jets.push_back(jet);
+        if(!has_jet_view) {
+            jetView.Reset(event);
+            has_jet_view = true;
         }
+        return jetView;
+    }
+
+    void SelectJetIndexes(std::vector<size_t>& indexes, double pt_cut = std::numeric_limits<double>::lowest(),
+                          double eta_cut = std::numeric_limits<double>::lowest(),
+                          double csv_cut = std::numeric_limits<double>::lowest(),
+                          JetOrdering jet_ordering = JetOrdering::CSV)
+    {
+        SelectJetIndexes(GetJetView(), indexes, pt_cut, eta_cut, csv_cut, jet_ordering);
+    }
 
-        if(jet_ordering != JetOrdering::NoOrdering)
-            std::sort(selected_jets.begin(), selected_jets.end(), orderer);
-        return selected_jets;
+    // The selected jets are stored into the caller-supplied collection, so that its storage can be reused between
+    // the events.
+    void SelectJets(JetCollection& selected_jets, double pt_cut = std::numeric_limits<double>::lowest(),
+                    double eta_cut = std::numeric_limits<double>::lowest(),
+                    double csv_cut = std::numeric_limits<double>::lowest(),
+                    JetOrdering jet_ordering = JetOrdering::CSV)
+    {
+        SelectJetIndexes(selected_jet_indexes, pt_cut, eta_cut, csv_cut, jet_ordering);
+        selected_jets.clear();
+        for(size_t index : selected_jet_indexes)
+            selected_jets.push_back(JetCandidate(GetTupleJet(index)));
     }
 
     const FatJetCollection& GetFatJets()
     {
-        if(!fatJets) {
-            fatJets = std::shared_ptr<FatJetCollection>(new FatJetCollection());
-            for(size_t n = 0; n < GetNFatJets(); ++n) {
-                tuple_fatJets.push_back(ntuple::TupleFatJet(*event, n));
-                fatJets->push_back(FatJetCandidate(tuple_fatJets.back()));
-            }
+        if(!has_fatJets) {
+            for(size_t n = 0; n < GetNFatJets(); ++n)
+                tuple_fatJets.emplace_back(event, n);
+            for(const ntuple::TupleFatJet& tuple_fatJet : tuple_fatJets)
+                fatJets.push_back(FatJetCandidate(tuple_fatJet));
+            has_fatJets = true;
         }
-        return *fatJets;
+        return fatJets;
     }
 
     bool HasBjetPair() const { return has_bjet_pair; }
@@ -224,19 +301,17 @@ public:
     {
         if(!HasBjetPair())
             throw exception("Can't create H->bb candidate.");
-        if(!higgs_bb) {
-            const auto& jets = GetJets();
-            higgs_bb = std::shared_ptr<HiggsBBCandidate>(
-                       new HiggsBBCandidate(jets.at(selected_bjet_pair.first), jets.at(selected_bjet_pair.second)));
-        }
+        if(!higgs_bb)
+            higgs_bb.emplace(JetCandidate(GetTupleJet(selected_bjet_pair.first)),
+                             JetCandidate(GetTupleJet(selected_bjet_pair.second)));
         return *higgs_bb;
     }
 
     const MET& GetMET()
     {
         if(!met) {
-            tuple_met = std::shared_ptr<ntuple::TupleMet>(new ntuple::TupleMet(*event, MetType::PF));
-            met = std::shared_ptr<MET>(new MET(*tuple_met, tuple_met->cov()));
+            tuple_met.emplace(event, MetType::PF);
+            met.emplace(*tuple_met, tuple_met->cov());
         }
         return *met;
     }
@@ -247,16 +322,17 @@ public:
             throw exception("Can't retrieve KinFit results.");
         if(!kinfit_results) {
             const size_t pairId = ntuple::CombinationPairToIndex(selected_bjet_pair, GetNJets());
-            const auto iter = std::find(event->kinFit_jetPairId.begin(), event->kinFit_jetPairId.end(), pairId);
-            if(iter == event->kinFit_jetPairId.end())
+            const auto& jetPairIds = event.kinFit_jetPairId();
+            const auto iter = std::find(jetPairIds.begin(), jetPairIds.end(), pairId);
+            if(iter == jetPairIds.end())
                 throw exception("Kinfit information for jet pair (%1%, %2%) is not stored for event %3%.")
                     % selected_bjet_pair.first % selected_bjet_pair.second % eventIdentifier;
-            const size_t index = static_cast<size_t>(std::distance(event->kinFit_jetPairId.begin(), iter));
-            kinfit_results = std::shared_ptr<kin_fit::FitResults>(new kin_fit::FitResults());
-            kinfit_results->convergence = event->kinFit_convergence.at(index);
-            kinfit_results->chi2 = event->kinFit_chi2.at(index);
+            const size_t index = static_cast<size_t>(std::distance(jetPairIds.begin(), iter));
+            kinfit_results.emplace();
+            kinfit_results->convergence = event.kinFit_convergence().at(index);
+            kinfit_results->chi2 = event.kinFit_chi2().at(index);
             kinfit_results->probability = TMath::Prob(kinfit_results->chi2, 2);
-            kinfit_results->mass = event->kinFit_m.at(index);
+            kinfit_results->mass = event.kinFit_m().at(index);
         }
         return *kinfit_results;
     }
@@ -274,10 +350,13 @@ public:
     double GetMT2()
     {
         if(!mt2.is_initialized()) {
-            const double mt2_1 = Calculate_MT2(event->p4_1, event->p4_2, GetHiggsBB().GetFirstDaughter().GetMomentum(),
-                                               GetHiggsBB().GetSecondDaughter().GetMomentum(), event->pfMET_p4);
-            const double mt2_2 = Calculate_MT2(event->p4_1, event->p4_2, GetHiggsBB().GetSecondDaughter().GetMomentum(),
-                                               GetHiggsBB().GetFirstDaughter().GetMomentum(), event->pfMET_p4);
+            const auto& p4_1 = event.p4_1();
+            const auto& p4_2 = event.p4_2();
+            const auto& met_p4 = event.pfMET_p4();
+            const double mt2_1 = Calculate_MT2(p4_1, p4_2, GetHiggsBB().GetFirstDaughter().GetMomentum(),
+                                               GetHiggsBB().GetSecondDaughter().GetMomentum(), met_p4);
+            const double mt2_2 = Calculate_MT2(p4_1, p4_2, GetHiggsBB().GetSecondDaughter().GetMomentum(),
+                                               GetHiggsBB().GetFirstDaughter().GetMomentum(), met_p4);
 
             mt2 = std::min(mt2_1, mt2_2);
         }
@@ -291,16 +370,22 @@ public:
         if(!HasBjetPair()) return nullptr;
         for(const FatJetCandidate& fatJet : GetFatJets()) {
             if(fatJet->m(FatJet::MassType::SoftDrop) < mass_cut) continue;
-            if(fatJet->subJets().size() < 2) continue;
-            std::vector<SubJet> subJets = fatJet->subJets();
-            std::sort(subJets.begin(), subJets.end(), [](const SubJet& j1, const SubJet& j2) -> bool {
-                return j1.p4().Pt() > j2.p4().Pt(); });
-            std::vector<double> deltaR;
+            std::array<const ntuple::LorentzVectorE*, 2> leadingSubJets = {{ nullptr, nullptr }};
+            fatJet->ForEachSubJet([&](const SubJet& subJet) {
+                const ntuple::LorentzVectorE* p4 = &subJet.p4();
+                if(!leadingSubJets.at(0) || p4->Pt() > leadingSubJets.at(0)->Pt()) {
+                    leadingSubJets.at(1) = leadingSubJets.at(0);
+                    leadingSubJets.at(0) = p4;
+                } else if(!leadingSubJets.at(1) || p4->Pt() > leadingSubJets.at(1)->Pt()) {
+                    leadingSubJets.at(1) = p4;
+                }
+            });
+            if(!leadingSubJets.at(1)) continue;
+            std::array<double, 4> deltaR;
             for(size_t n = 0; n < 2; ++n) {
                 for(size_t k = 0; k < 2; ++k) {
-                    const auto dR = ROOT::Math::VectorUtil::DeltaR(subJets.at(n).p4(),
-                                                                   GetHiggsBB().GetDaughterMomentums().at(k));
-                    deltaR.push_back(dR);
+                    deltaR.at(n * 2 + k) = ROOT::Math::VectorUtil::DeltaR(*leadingSubJets.at(n),
+                                                                          GetHiggsBB().GetDaughterMomentums().at(k));
                 }
             }
             if((deltaR.at(0) < deltaR_subjet_cut && deltaR.at(3) < deltaR_subjet_cut)
@@ -313,8 +398,17 @@ public:
     void SetMvaScore(double _mva_score) { mva_score = _mva_score; }
     double GetMvaScore() const { return mva_score; }
 
+private:
+    const Event& GetFullEvent() const
+    {
+        if(event.GetMissingBranches().any())
+            throw exception("Event %1% is partially stored. Missing branches should be accessed through the event"
+                            " accessor.") % eventIdentifier;
+        return event.GetEvent();
+    }
+
 protected:
-    const Event* event;
+    EventAccessor event;
     const SummaryInfo* summaryInfo;
     TriggerResults triggerResults;
 
@@ -323,14 +417,19 @@ private:
     JetPair selected_bjet_pair;
     bool has_bjet_pair;
 
-    std::list<ntuple::TupleJet> tuple_jets;
-    std::shared_ptr<JetCollection> jets;
-    std::list<ntuple::TupleFatJet> tuple_fatJets;
-    std::shared_ptr<FatJetCollection> fatJets;
-    std::shared_ptr<HiggsBBCandidate> higgs_bb;
-    std::shared_ptr<ntuple::TupleMet> tuple_met;
-    std::shared_ptr<MET> met;
-    std::shared_ptr<kin_fit::FitResults> kinfit_results;
+    ntuple::TupleJetView jetView;
+    bool has_jet_view;
+    std::vector<size_t> selected_jet_indexes;
+    bool has_jets;
+    std::vector<boost::optional<ntuple::TupleJet>> tuple_jets;
+    JetCollection jets;
+    bool has_fatJets;
+    std::vector<ntuple::TupleFatJet> tuple_fatJets;
+    FatJetCollection fatJets;
+    boost::optional<HiggsBBCandidate> higgs_bb;
+    boost::optional<ntuple::TupleMet> tuple_met;
+    boost::optional<MET> met;
+    boost::optional<kin_fit::FitResults> kinfit_results;
     boost::optional<double> mt2;
     double mva_score;
 };
@@ -346,7 +445,7 @@ public:
 
     static constexpr Channel channel = ChannelInfo::IdentifyChannel<FirstLeg, SecondLeg>();
 
-    EventInfo(const Event& _event, const JetPair& _selected_bjet_pair = JetPair(0, 1),
+    EventInfo(const EventAccessor& _event, const JetPair& _selected_bjet_pair = JetPair(0, 1),
               const SummaryInfo* _summaryInfo = nullptr) :
         EventInfoBase(_event, _selected_bjet_pair, _summaryInfo)
     {
@@ -356,11 +455,22 @@ public:
 
     using EventInfoBase::EventInfoBase;
 
+    virtual void Reset(const EventAccessor& _event, const JetPair& _selected_bjet_pair = JetPair(0, 1)) override
+    {
+        EventInfoBase::Reset(_event, _selected_bjet_pair);
+        higgs_tt = boost::none;
+        higgs_tt_sv = boost::none;
+        leg1 = boost::none;
+        tuple_leg1 = boost::none;
+        leg2 = boost::none;
+        tuple_leg2 = boost::none;
+    }
+
     const FirstLeg& GetFirstLeg()
     {
         if(!leg1) {
-            tuple_leg1 = std::shared_ptr<FirstTupleLeg>(new FirstTupleLeg(*event, 1));
-            leg1 = std::shared_ptr<FirstLeg>(new FirstLeg(*tuple_leg1, tuple_leg1->iso()));
+            tuple_leg1.emplace(event, 1);
+            leg1.emplace(*tuple_leg1, tuple_leg1->iso());
         }
         return *leg1;
     }
@@ -368,8 +478,8 @@ public:
     const SecondLeg& GetSecondLeg()
     {
         if(!leg2) {
-            tuple_leg2 = std::shared_ptr<SecondTupleLeg>(new SecondTupleLeg(*event, 2));
-            leg2 = std::shared_ptr<SecondLeg>(new SecondLeg(*tuple_leg2, tuple_leg2->iso()));
+            tuple_leg2.emplace(event, 2);
+            leg2.emplace(*tuple_leg2, tuple_leg2->iso());
         }
         return *leg2;
     }
@@ -384,14 +494,12 @@ public:
     const HiggsTTCandidate& GetHiggsTT(bool useSVfit)
     {
         if(useSVfit) {
-            if(!higgs_tt_sv) {
-                higgs_tt_sv = std::shared_ptr<HiggsTTCandidate>(
-                              new HiggsTTCandidate(GetFirstLeg(), GetSecondLeg(), event->SVfit_p4));
-            }
+            if(!higgs_tt_sv)
+                higgs_tt_sv.emplace(GetFirstLeg(), GetSecondLeg(), event.SVfit_p4());
             return *higgs_tt_sv;
         }
         if(!higgs_tt)
-            higgs_tt = std::shared_ptr<HiggsTTCandidate>(new HiggsTTCandidate(GetFirstLeg(), GetSecondLeg()));
+            higgs_tt.emplace(GetFirstLeg(), GetSecondLeg());
         return *higgs_tt;
     }
 
@@ -401,15 +509,15 @@ public:
     }
 
 private:
-    std::shared_ptr<FirstTupleLeg> tuple_leg1;
-    std::shared_ptr<FirstLeg> leg1;
-    std::shared_ptr<SecondTupleLeg> tuple_leg2;
-    std::shared_ptr<SecondLeg> leg2;
-    std::shared_ptr<HiggsTTCandidate> higgs_tt, higgs_tt_sv;
+    boost::optional<FirstTupleLeg> tuple_leg1;
+    boost::optional<FirstLeg> leg1;
+    boost::optional<SecondTupleLeg> tuple_leg2;
+    boost::optional<SecondLeg> leg2;
+    boost::optional<HiggsTTCandidate> higgs_tt, higgs_tt_sv;
 };
 
 inline std::shared_ptr<EventInfoBase> MakeEventInfo(
-        Channel channel, const EventInfoBase::Event& event,
+        Channel channel, const EventInfoBase::EventAccessor& event,
         const EventInfoBase::JetPair& selected_bjet_pair = EventInfoBase::JetPair(0, 1),
         const SummaryInfo* summaryInfo = nullptr)
 {
@@ -3,6 +3,13 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstring>
+#include <map>
+#include <TBranch.h>
+#include <TTree.h>
 #include "AnalysisTools/Core/include/SmartTree.h"
 #include "AnalysisTools/Core/include/AnalysisMath.h"
 
@@ -73,6 +80,7 @@ using MetCovMatrix = analysis::SquareMatrix<2>;
     VAR(Int_t, genEventType) /* gen event type */ \
     VAR(Float_t, genEventWeight) /* gen event weight */ \
     VAR(UInt_t, storageMode) /* for non-central ES, description of the relation with central ES event */ \
+    VAR(std::vector<ULong64_t>, storageMask) /* for non-central ES, bits of branches taken from central ES event */ \
 	/* Event Weights Variables */ \
     VAR(Double_t, weight_pu) \
     VAR(Double_t, weight_lepton_trig) \
@@ -151,6 +159,328 @@ DECLARE_TREE(ntuple, Event, EventTuple, EVENT_DATA, "events")
 #define VAR(type, name) ADD_DATA_TREE_BRANCH(name)
 INITIALIZE_TREE(ntuple, EventTuple, EVENT_DATA)
 #undef VAR
+
+namespace ntuple {
+#define VAR(type, name) name,
+enum class EventBranch : size_t { EVENT_DATA() };
+#undef VAR
+
+#define VAR(type, name) + 1
+constexpr size_t NumberOfEventBranches = 0 EVENT_DATA();
+#undef VAR
+
+using EventBranchMask = std::bitset<NumberOfEventBranches>;
+
+inline const std::vector<std::string>& EventBranchNames()
+{
+#define VAR(type, name) #name,
+    static const std::vector<std::string> names = { EVENT_DATA() };
+#undef VAR
+    return names;
+}
+
+// Marks the branches accessed through EventAccessor while a branch usage recorder is active (see BranchUsageRecorder
+// in BranchUsage.h). Each branch has an atomic bit, which is modified only on the first access, so in the steady
+// state, as well as when no recorder is active, the access costs only relaxed atomic loads.
+class EventBranchUsage {
+public:
+    static void Record(EventBranch branch)
+    {
+        EventBranchUsage* usage = Active().load(std::memory_order_relaxed);
+        if(usage)
+            usage->Mark(static_cast<size_t>(branch));
+    }
+
+    EventBranchMask GetUsedBranches() const
+    {
+        EventBranchMask mask;
+        for(size_t n = 0; n < NumberOfEventBranches; ++n) {
+            if(used[n / WordSize].load(std::memory_order_relaxed) & Bit(n))
+                mask.set(n);
+        }
+        return mask;
+    }
+
+protected:
+    EventBranchUsage()
+    {
+        for(auto& word : used)
+            word.store(0);
+    }
+
+    EventBranchUsage(const EventBranchUsage&) = delete;
+    EventBranchUsage& operator=(const EventBranchUsage&) = delete;
+
+    static std::atomic<EventBranchUsage*>& Active()
+    {
+        static std::atomic<EventBranchUsage*> active(nullptr);
+        return active;
+    }
+
+private:
+    static constexpr size_t WordSize = 64;
+    static constexpr size_t NumberOfWords = (NumberOfEventBranches + WordSize - 1) / WordSize;
+
+    static ULong64_t Bit(size_t n) { return ULong64_t(1) << (n % WordSize); }
+
+    void Mark(size_t n)
+    {
+        std::atomic<ULong64_t>& word = used[n / WordSize];
+        const ULong64_t bit = Bit(n);
+        if(!(word.load(std::memory_order_relaxed) & bit))
+            word.fetch_or(bit, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<ULong64_t>, NumberOfWords> used;
+};
+
+// FNV-1a hash of the types and names of the branches in the order of their declaration. The order defines the bit
+// positions in the storage mask, so masks can be decoded only with the same layout that was used to encode them.
+inline ULong64_t EventBranchLayoutHash()
+{
+#define VAR(type, name) #type " " #name,
+    static const std::vector<std::string> layout = { EVENT_DATA() };
+#undef VAR
+    static const ULong64_t hash = []() {
+        ULong64_t h = 14695981039346656037ULL;
+        for(const std::string& item : layout) {
+            for(size_t n = 0; n <= item.size(); ++n) {
+                h ^= static_cast<unsigned char>(item.c_str()[n]);
+                h *= 1099511628211ULL;
+            }
+        }
+        return h;
+    }();
+    return hash;
+}
+
+// Branches that identify the event and its storage mode are always stored.
+inline bool IsReferenceCompatibleBranch(EventBranch branch)
+{
+    return branch != EventBranch::run && branch != EventBranch::lumi && branch != EventBranch::evt
+        && branch != EventBranch::eventEnergyScale && branch != EventBranch::storageMode
+        && branch != EventBranch::storageMask;
+}
+
+namespace detail {
+template<typename T>
+bool IsSameBranchValue(const T& a, const T& b) { return a == b; }
+
+// Floating point values are compared bitwise, so that the restored value is exactly the original one.
+inline bool IsSameBranchValue(const float& a, const float& b) { return !std::memcmp(&a, &b, sizeof(float)); }
+inline bool IsSameBranchValue(const double& a, const double& b) { return !std::memcmp(&a, &b, sizeof(double)); }
+
+template<typename Vector>
+bool IsSameBranchValue(const ROOT::Math::LorentzVector<Vector>& a, const ROOT::Math::LorentzVector<Vector>& b)
+{
+    typename ROOT::Math::LorentzVector<Vector>::Scalar a_coordinates[4], b_coordinates[4];
+    a.GetCoordinates(a_coordinates);
+    b.GetCoordinates(b_coordinates);
+    return !std::memcmp(a_coordinates, b_coordinates, sizeof(a_coordinates));
+}
+
+template<typename T, unsigned D1, unsigned D2, typename Rep>
+bool IsSameBranchValue(const ROOT::Math::SMatrix<T, D1, D2, Rep>& a, const ROOT::Math::SMatrix<T, D1, D2, Rep>& b)
+{
+    for(unsigned i = 0; i < D1; ++i) {
+        for(unsigned j = 0; j < D2; ++j) {
+            if(!IsSameBranchValue(a(i, j), b(i, j))) return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+bool IsSameBranchValue(const std::vector<T>& a, const std::vector<T>& b)
+{
+    if(a.size() != b.size()) return false;
+    for(size_t n = 0; n < a.size(); ++n) {
+        if(!IsSameBranchValue(a[n], b[n])) return false;
+    }
+    return true;
+}
+} // namespace detail
+
+// Clears branches of the event that are identical to the branches of the reference event and returns the mask of the
+// cleared branches. Cleared branches are stored with the default values, which take almost no space after the
+// compression.
+inline EventBranchMask ClearBranchesSameAsReference(Event& event, const Event& ref)
+{
+    EventBranchMask mask;
+#define VAR(type, name) \
+    if(IsReferenceCompatibleBranch(EventBranch::name) && detail::IsSameBranchValue(event.name, ref.name)) { \
+        mask.set(static_cast<size_t>(EventBranch::name)); \
+        event.name = type(); \
+    }
+    EVENT_DATA()
+#undef VAR
+    return mask;
+}
+
+inline void CopyBranchesFromReference(Event& event, const Event& ref, const EventBranchMask& mask)
+{
+#define VAR(type, name) \
+    if(mask[static_cast<size_t>(EventBranch::name)]) event.name = ref.name;
+    EVENT_DATA()
+#undef VAR
+}
+
+// The mask is stored as the layout hash followed by a sequence of 64-bit words. An empty sequence means that all
+// branches are stored.
+inline std::vector<ULong64_t> EncodeBranchMask(const EventBranchMask& mask)
+{
+    static constexpr size_t WordSize = 64;
+    std::vector<ULong64_t> words;
+    if(mask.none()) return words;
+    words.resize(1 + (NumberOfEventBranches + WordSize - 1) / WordSize, 0);
+    words.front() = EventBranchLayoutHash();
+    for(size_t n = 0; n < NumberOfEventBranches; ++n) {
+        if(mask[n])
+            words[1 + n / WordSize] |= ULong64_t(1) << (n % WordSize);
+    }
+    return words;
+}
+
+inline EventBranchMask DecodeBranchMask(const std::vector<ULong64_t>& words)
+{
+    static constexpr size_t WordSize = 64;
+    static constexpr size_t NumberOfWords = 1 + (NumberOfEventBranches + WordSize - 1) / WordSize;
+    EventBranchMask mask;
+    if(words.empty()) return mask;
+    if(words.size() != NumberOfWords || words.front() != EventBranchLayoutHash())
+        throw analysis::exception("Storage mask is encoded with a different layout of the event branches:"
+                                  " n_words = %1%, layout hash = %2%. Expected: n_words = %3%, layout hash = %4%.")
+            % words.size() % words.front() % NumberOfWords % EventBranchLayoutHash();
+    for(size_t n = 0; n < NumberOfEventBranches; ++n)
+        mask[n] = (words[1 + n / WordSize] >> (n % WordSize)) & 1;
+    return mask;
+}
+
+// Parts of the event that are not stored in the entry and are taken from the reference entry of the same event.
+class StorageMode {
+public:
+    static constexpr size_t NumberOfParts = 5;
+    enum class EventPart { FirstTauIds = 0, SecondTauIds = 1, Jets = 2, FatJets = 3, GenInfo = 4 };
+
+    static const StorageMode& Full() { static const StorageMode m(0); return m; }
+
+    explicit StorageMode(unsigned _mode = 0) : mode_bits(_mode) {}
+    unsigned long Mode() const { return mode_bits.to_ulong(); }
+    bool IsFull() const { return Mode() == 0; }
+    bool IsMissing(EventPart part) const { return mode_bits[static_cast<size_t>(part)]; }
+    bool IsPresent(EventPart part) const { return !IsMissing(part); }
+    void SetPresence(EventPart part, bool presence) { mode_bits[static_cast<size_t>(part)] = !presence; }
+
+    bool operator==(const StorageMode& other) const { return Mode() == other.Mode(); }
+    bool operator!=(const StorageMode& other) const { return Mode() != other.Mode(); }
+
+private:
+    std::bitset<NumberOfParts> mode_bits;
+};
+
+inline EventBranchMask MakeBranchMask(const std::vector<EventBranch>& branches)
+{
+    EventBranchMask mask;
+    for(EventBranch branch : branches)
+        mask.set(static_cast<size_t>(branch));
+    return mask;
+}
+
+inline const EventBranchMask& GetStoragePartBranches(StorageMode::EventPart part)
+{
+    using EventPart = StorageMode::EventPart;
+    static const std::map<EventPart, EventBranchMask> part_branches = {
+        { EventPart::FirstTauIds, MakeBranchMask({ EventBranch::tauId_keys_1, EventBranch::tauId_values_1 }) },
+        { EventPart::SecondTauIds, MakeBranchMask({ EventBranch::tauId_keys_2, EventBranch::tauId_values_2 }) },
+        { EventPart::Jets, MakeBranchMask({
+            EventBranch::jets_p4, EventBranch::jets_csv, EventBranch::jets_rawf, EventBranch::jets_mva,
+            EventBranch::jets_partonFlavour, EventBranch::jets_hadronFlavour }) },
+        { EventPart::FatJets, MakeBranchMask({
+            EventBranch::fatJets_p4, EventBranch::fatJets_csv, EventBranch::fatJets_m_pruned,
+            EventBranch::fatJets_m_softDrop, EventBranch::fatJets_n_subjettiness_tau1,
+            EventBranch::fatJets_n_subjettiness_tau2, EventBranch::fatJets_n_subjettiness_tau3,
+            EventBranch::subJets_p4, EventBranch::subJets_csv, EventBranch::subJets_parentIndex }) },
+        { EventPart::GenInfo, MakeBranchMask({
+            EventBranch::genEventType, EventBranch::genEventWeight, EventBranch::lhe_n_partons,
+            EventBranch::lhe_n_c_partons, EventBranch::lhe_n_b_partons, EventBranch::lhe_HT,
+            EventBranch::lhe_H_m, EventBranch::lhe_hh_m, EventBranch::lhe_hh_cosTheta,
+            EventBranch::genParticles_pdg, EventBranch::genParticles_p4,
+            EventBranch::genParticles_nPromptElectrons, EventBranch::genParticles_nPromptMuons,
+            EventBranch::genParticles_nPromptTaus, EventBranch::genJets_nTotal,
+            EventBranch::jets_nTotal_partonFlavour_b, EventBranch::jets_nTotal_partonFlavour_c,
+            EventBranch::jets_nTotal_hadronFlavour_b, EventBranch::jets_nTotal_hadronFlavour_c,
+            EventBranch::genJets_p4, EventBranch::genJets_partonFlavour, EventBranch::genJets_hadronFlavour }) },
+    };
+    return part_branches.at(part);
+}
+
+// Branches that are not stored in the entry and should be taken from the reference: the parts marked in storageMode
+// and the branches marked in storageMask.
+inline EventBranchMask GetMissingBranches(const Event& event)
+{
+    using EventPart = StorageMode::EventPart;
+    static const std::vector<EventPart> parts = {
+        EventPart::FirstTauIds, EventPart::SecondTauIds, EventPart::Jets, EventPart::FatJets, EventPart::GenInfo
+    };
+
+    EventBranchMask missingBranches = DecodeBranchMask(event.storageMask);
+    const StorageMode mode(event.storageMode);
+    if(mode.IsFull()) return missingBranches;
+    for(EventPart part : parts) {
+        if(mode.IsMissing(part))
+            missingBranches |= GetStoragePartBranches(part);
+    }
+    return missingBranches;
+}
+
+// Read-only access to the event branches. Branches marked as missing are taken directly from the reference event, so
+// partially stored events can be used without copying the reference branches. Each access is reported to the active
+// branch usage recorder. An accessor without the reference can be created only for a fully stored event: partially
+// stored events should be accessed through EventLoader::CreateAccessor or ReferenceEventResolver::CreateAccessor.
+class EventAccessor {
+public:
+    explicit EventAccessor(const Event& _event) :
+        event(&_event), ref(nullptr), missing(ntuple::GetMissingBranches(_event))
+    {
+        if(missing.any())
+            throw analysis::exception("Event %1%:%2%:%3% is partially stored. Reference event is required to access"
+                                      " the missing branches.") % _event.run % _event.lumi % _event.evt;
+    }
+
+    EventAccessor(const Event& _event, const Event* _ref, const EventBranchMask& _missing) :
+        event(&_event), ref(_ref), missing(_missing)
+    {
+        if(missing.any() && !ref)
+            throw analysis::exception("Reference event is required to access the missing branches.");
+    }
+
+    const Event& GetEvent() const { return *event; }
+    const Event* GetReference() const { return ref; }
+    const EventBranchMask& GetMissingBranches() const { return missing; }
+
+#define VAR(type, name) \
+    const type& name() const \
+    { \
+        EventBranchUsage::Record(EventBranch::name); \
+        return GetSource(EventBranch::name).name; \
+    }
+    EVENT_DATA()
+#undef VAR
+
+private:
+    const Event& GetSource(EventBranch branch) const
+    {
+        return missing[static_cast<size_t>(branch)] ? *ref : *event;
+    }
+
+private:
+    const Event* event;
+    const Event* ref;
+    EventBranchMask missing;
+};
+} // namespace ntuple
+
 #undef EVENT_DATA
 #undef LEG_DATA
 #undef LVAR
@@ -203,9 +533,119 @@ inline JetPair UndefinedJetPair()
     return pair;
 }
 
+// Storage settings of the output branches. Zero basket size or negative compression settings keep the defaults of
+// the tree and of the output file.
+struct BranchStorageSettings {
+    Int_t basketSize; // basket size in bytes
+    Int_t compressionSettings; // ROOT compression settings: 100 * algorithm + level
+
+    BranchStorageSettings(Int_t _basketSize = 0, Int_t _compressionSettings = -1) :
+        basketSize(_basketSize), compressionSettings(_compressionSettings) {}
+};
+
+// Settings are assigned to the branches by the exact branch name or by the name prefix, if the key ends with '*'.
+// If several keys match a branch, the exact name has priority over the longest prefix.
+using BranchStorageSettingsMap = std::map<std::string, BranchStorageSettings>;
+
+struct EventTupleOptions {
+    bool ignore_trigger_branches;
+    std::set<std::string> enabled_branches; // if not empty, only these branches are read
+    BranchStorageSettingsMap storageSettings; // applied to the output branches only
+
+    explicit EventTupleOptions(bool _ignore_trigger_branches = false) :
+        ignore_trigger_branches(_ignore_trigger_branches) {}
+};
+
+// Larger baskets for the collection branches, so that each basket holds a reasonable number of events and the
+// compression works on longer runs of similar values.
+inline const BranchStorageSettingsMap& VectorBranchStorageSettings()
+{
+    static const BranchStorageSettingsMap settings = {
+        { "tauId_*", BranchStorageSettings(256000) },
+        { "jets_*", BranchStorageSettings(256000) },
+        { "fatJets_*", BranchStorageSettings(256000) },
+        { "subJets_*", BranchStorageSettings(256000) },
+        { "kinFit_*", BranchStorageSettings(128000) },
+        { "genParticles_*", BranchStorageSettings(256000) },
+        { "genJets_*", BranchStorageSettings(256000) },
+    };
+    return settings;
+}
+
+namespace detail {
+inline TTree* FindEventTree(const std::string& name, TDirectory* directory)
+{
+    TTree* tree = directory ? dynamic_cast<TTree*>(directory->Get(name.c_str())) : nullptr;
+    if(!tree)
+        throw analysis::exception("Tree '%1%' not found in '%2%'.") % name
+            % (directory ? directory->GetName() : "nullptr");
+    return tree;
+}
+
+inline const BranchStorageSettings* FindStorageSettings(const BranchStorageSettingsMap& settings,
+                                                        const std::string& branch_name)
+{
+    auto iter = settings.find(branch_name);
+    if(iter != settings.end())
+        return &iter->second;
+    const BranchStorageSettings* best = nullptr;
+    size_t best_length = 0;
+    for(const auto& item : settings) {
+        const std::string& key = item.first;
+        if(key.empty() || key.back() != '*') continue;
+        const size_t length = key.size() - 1;
+        if(length >= best_length && branch_name.compare(0, length, key, 0, length) == 0) {
+            best = &item.second;
+            best_length = length;
+        }
+    }
+    return best;
+}
+
+inline void ApplyStorageSettings(TBranch& branch, const BranchStorageSettings& settings)
+{
+    if(settings.basketSize > 0)
+        branch.SetBasketSize(settings.basketSize);
+    if(settings.compressionSettings >= 0)
+        branch.SetCompressionSettings(settings.compressionSettings);
+    TObjArray* sub_branches = branch.GetListOfBranches();
+    for(Int_t n = 0; sub_branches && n < sub_branches->GetEntriesFast(); ++n) {
+        if(TBranch* sub_branch = dynamic_cast<TBranch*>(sub_branches->At(n)))
+            ApplyStorageSettings(*sub_branch, settings);
+    }
+}
+} // namespace detail
+
+// Branches of the tree stored in the directory that are not in the allow-list.
+inline std::set<std::string> GetNotEnabledBranches(const std::string& name, TDirectory* directory,
+                                                   const std::set<std::string>& enabled_branches)
+{
+    std::set<std::string> not_enabled;
+    TObjArray* branches = detail::FindEventTree(name, directory)->GetListOfBranches();
+    for(Int_t n = 0; n < branches->GetEntriesFast(); ++n) {
+        const std::string branch_name = branches->At(n)->GetName();
+        if(!enabled_branches.count(branch_name))
+            not_enabled.insert(branch_name);
+    }
+    return not_enabled;
+}
+
+inline void SetStorageSettings(const std::string& name, TDirectory* directory,
+                               const BranchStorageSettingsMap& settings)
+{
+    if(settings.empty()) return;
+    TObjArray* branches = detail::FindEventTree(name, directory)->GetListOfBranches();
+    for(Int_t n = 0; n < branches->GetEntriesFast(); ++n) {
+        TBranch* branch = dynamic_cast<TBranch*>(branches->At(n));
+        if(!branch) continue;
+        if(const BranchStorageSettings* branch_settings = detail::FindStorageSettings(settings, branch->GetName()))
+            detail::ApplyStorageSettings(*branch, *branch_settings);
+    }
+}
+
 inline std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory* directory,
                                                     bool readMode, TreeState treeState,
-                                                    bool ignore_trigger_branches = false)
+                                                    const EventTupleOptions& options)
 {
     static const std::map<TreeState, std::set<std::string>> disabled_branches = {
         { TreeState::Full, { "n_jets", "ht_other_jets", "weight_pu", "weight_lepton_trig", "weight_lepton_id_iso",
@@ -215,12 +655,38 @@ inline std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDi
         { TreeState::Skimmed, { "decayMode_1", "decayMode_2" } }
     };
 
+    // Branches added to the format after the tuples were already in production. If such a branch is absent in the
+    // input tuple, it is not read and keeps the default value, e.g. an empty storageMask means that all branches of
+    // the event are stored.
+    static const std::set<std::string> optional_branches = { "storageMask" };
+
     static const std::set<std::string> trigger_branches = { "trigger_accepts", "trigger_matches" };
     auto disabled = disabled_branches.at(treeState);
-    if(ignore_trigger_branches)
+    if(options.ignore_trigger_branches)
         disabled.insert(trigger_branches.begin(), trigger_branches.end());
+    if(readMode && !options.enabled_branches.empty()) {
+        const auto not_enabled = GetNotEnabledBranches(name, directory, options.enabled_branches);
+        disabled.insert(not_enabled.begin(), not_enabled.end());
+    }
+    if(readMode) {
+        TTree* tree = detail::FindEventTree(name, directory);
+        for(const auto& branch_name : optional_branches) {
+            if(!tree->GetBranch(branch_name.c_str()))
+                disabled.insert(branch_name);
+        }
+    }
 
-    return std::make_shared<EventTuple>(name, directory, readMode, disabled);
+    auto tuple = std::make_shared<EventTuple>(name, directory, readMode, disabled);
+    if(!readMode)
+        SetStorageSettings(name, directory, options.storageSettings);
+    return tuple;
+}
+
+inline std::shared_ptr<EventTuple> CreateEventTuple(const std::string& name, TDirectory* directory,
+                                                    bool readMode, TreeState treeState,
+                                                    bool ignore_trigger_branches = false)
+{
+    return CreateEventTuple(name, directory, readMode, treeState, EventTupleOptions(ignore_trigger_branches));
 }
 
 } // namespace ntuple
@@ -0,0 +1,121 @@
+/*! Resolver of the reference events for the partially stored entries of the event tuple.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "BranchUsage.h"
+#include "EventLoader.h"
+
+namespace ntuple {
+
+// Partially stored entries refer to the last fully stored entry of the same event that precedes them in the tree.
+// The resolver finds this entry by (run, lumi, evt) and the entry number, so that the entries can be loaded in any
+// order and from any thread. The index of the fully stored entries is a sorted flat array (24 bytes per entry).
+// The resolver reads the references through its own handle of the input file and keeps the most recently used ones
+// in the cache.
+class ReferenceEventResolver {
+public:
+    using EventPtr = std::shared_ptr<const Event>;
+    using EventId = std::tuple<UInt_t, UInt_t, ULong64_t>;
+    using IndexEntry = std::pair<EventId, Long64_t>;
+
+    ReferenceEventResolver(const std::string& file_name, const std::string& tree_name, TreeState treeState,
+                           const EventTupleOptions& options = EventTupleOptions(), size_t _max_cache_size = 16) :
+        max_cache_size(std::max<size_t>(_max_cache_size, 1))
+    {
+        BuildIndex(file_name, tree_name, treeState, options);
+        file = root_ext::OpenRootFile(file_name);
+        tuple = CreateEventTuple(tree_name, file.get(), true, treeState, options);
+    }
+
+    ReferenceEventResolver(const ReferenceEventResolver&) = delete;
+    ReferenceEventResolver& operator=(const ReferenceEventResolver&) = delete;
+
+    size_t GetNumberOfReferences() const { return index.size(); }
+
+    // Returns the reference for the event stored in the given entry, or nullptr if the event is fully stored.
+    EventPtr GetReference(const Event& event, Long64_t entry)
+    {
+        if(EventLoader::IsFullyStored(event)) return EventPtr();
+        const Long64_t ref_entry = FindReferenceEntry(event, entry);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = cache.find(ref_entry);
+        if(iter != cache.end()) {
+            usage_order.splice(usage_order.begin(), usage_order, iter->second.second);
+            return iter->second.first;
+        }
+
+        tuple->GetEntry(ref_entry);
+        EventPtr ref = std::make_shared<const Event>(tuple->data());
+        if(cache.size() >= max_cache_size) {
+            cache.erase(usage_order.back());
+            usage_order.pop_back();
+        }
+        usage_order.push_front(ref_entry);
+        cache[ref_entry] = std::make_pair(ref, usage_order.begin());
+        return ref;
+    }
+
+    // Copies the missing branches from the reference.
+    StorageMode Load(Event& event, Long64_t entry)
+    {
+        const EventPtr ref = GetReference(event, entry);
+        return EventLoader::Load(event, ref.get());
+    }
+
+    // Provides access to the missing branches of the reference without copying them. The returned reference pointer
+    // should be kept while the accessor is in use.
+    EventAccessor CreateAccessor(const Event& event, Long64_t entry, EventPtr& ref)
+    {
+        ref = GetReference(event, entry);
+        return EventLoader::CreateAccessor(event, ref.get());
+    }
+
+private:
+    void BuildIndex(const std::string& file_name, const std::string& tree_name, TreeState treeState,
+                    const EventTupleOptions& options)
+    {
+        auto index_file = root_ext::OpenRootFile(file_name);
+        EventTupleOptions index_options(options);
+        index_options.enabled_branches = BranchUsageRecorder::EssentialBranches();
+        auto index_tuple = CreateEventTuple(tree_name, index_file.get(), true, treeState, index_options);
+        const Long64_t n_entries = index_tuple->GetEntries();
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            index_tuple->GetEntry(entry);
+            const Event& event = index_tuple->data();
+            if(!EventLoader::IsFullyStored(event)) continue;
+            index.emplace_back(EventId(event.run, event.lumi, event.evt), entry);
+        }
+        index.shrink_to_fit();
+        std::sort(index.begin(), index.end());
+    }
+
+    Long64_t FindReferenceEntry(const Event& event, Long64_t entry) const
+    {
+        const EventId id(event.run, event.lumi, event.evt);
+        const auto iter = std::lower_bound(index.begin(), index.end(), IndexEntry(id, entry));
+        if(iter != index.begin() && (iter - 1)->first == id)
+            return (iter - 1)->second;
+        throw analysis::exception("Reference entry not found for event %1%:%2%:%3% stored in entry %4%.")
+            % event.run % event.lumi % event.evt % entry;
+    }
+
+private:
+    size_t max_cache_size;
+    std::vector<IndexEntry> index; // fully stored entries sorted by the event id and the entry number
+    std::shared_ptr<TFile> file;
+    std::shared_ptr<EventTuple> tuple;
+    std::mutex mutex;
+    std::list<Long64_t> usage_order;
+    std::map<Long64_t, std::pair<EventPtr, std::list<Long64_t>::iterator>> cache;
+};
+
+} // namespace ntuple
@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <cstring>
 #include "AnalysisTools/Core/include/SmartTree.h"
 #include "AnalysisTools/Core/include/AnalysisMath.h"
 
@@ -151,6 +152,27 @@ DECLARE_TREE(htt_sync, SyncEvent, SyncTuple, SYNC_DATA, "events")
 #define VAR(type, name) ADD_DATA_TREE_BRANCH(name)
 INITIALIZE_TREE(htt_sync, SyncTuple, SYNC_DATA)
 #undef VAR
+
+namespace htt_sync {
+namespace detail {
+template<typename T>
+bool IsSameValue(const T& a, const T& b) { return a == b; }
+
+// Floating point values are compared bitwise, so that default and NaN values are treated as equal.
+inline bool IsSameValue(const Float_t& a, const Float_t& b) { return !std::memcmp(&a, &b, sizeof(Float_t)); }
+} // namespace detail
+
+// Names of the branches that have different values in the two events.
+inline std::vector<std::string> FindDifferentBranches(const SyncEvent& event, const SyncEvent& other)
+{
+    std::vector<std::string> different;
+#define VAR(type, name) if(!detail::IsSameValue(event.name, other.name)) different.push_back(#name);
+    SYNC_DATA()
+#undef VAR
+    return different;
+}
+} // namespace htt_sync
+
 #undef SYNC_DATA
 #undef LEG_DATA
 #undef LVAR
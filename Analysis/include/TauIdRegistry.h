@@ -0,0 +1,213 @@
+/*! Compile-time registry of the tau ID discriminators stored in the tuples.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include "AnalysisTools/Core/include/Tools.h"
+#include "AnalysisTypes.h"
+
+#define TAU_ID_ISO_MVA(dm, lt) \
+    TAU_ID(byIsolationMVArun2v1DB##dm##DM##lt##LTraw) \
+    TAU_ID(byVLooseIsolationMVArun2v1DB##dm##DM##lt##LT) \
+    TAU_ID(byLooseIsolationMVArun2v1DB##dm##DM##lt##LT) \
+    TAU_ID(byMediumIsolationMVArun2v1DB##dm##DM##lt##LT) \
+    TAU_ID(byTightIsolationMVArun2v1DB##dm##DM##lt##LT) \
+    TAU_ID(byVTightIsolationMVArun2v1DB##dm##DM##lt##LT) \
+    TAU_ID(byVVTightIsolationMVArun2v1DB##dm##DM##lt##LT) \
+    /**/
+
+#define TAU_IDS() \
+    TAU_ID(decayModeFinding) \
+    TAU_ID(decayModeFindingNewDMs) \
+    TAU_ID(decayModeFindingOldDMs) \
+    TAU_ID(againstElectronMVA6Raw) \
+    TAU_ID(againstElectronVLooseMVA6) \
+    TAU_ID(againstElectronLooseMVA6) \
+    TAU_ID(againstElectronMediumMVA6) \
+    TAU_ID(againstElectronTightMVA6) \
+    TAU_ID(againstElectronVTightMVA6) \
+    TAU_ID(againstMuonLoose3) \
+    TAU_ID(againstMuonTight3) \
+    TAU_ID(byCombinedIsolationDeltaBetaCorrRaw3Hits) \
+    TAU_ID(byLooseCombinedIsolationDeltaBetaCorr3Hits) \
+    TAU_ID(byMediumCombinedIsolationDeltaBetaCorr3Hits) \
+    TAU_ID(byTightCombinedIsolationDeltaBetaCorr3Hits) \
+    TAU_ID(chargedIsoPtSum) \
+    TAU_ID(neutralIsoPtSum) \
+    TAU_ID(puCorrPtSum) \
+    TAU_ID(byIsolationMVA3oldDMwoLTraw) \
+    TAU_ID(byIsolationMVA3oldDMwLTraw) \
+    TAU_ID(byIsolationMVA3newDMwoLTraw) \
+    TAU_ID(byIsolationMVA3newDMwLTraw) \
+    TAU_ID_ISO_MVA(old, w) \
+    TAU_ID_ISO_MVA(old, wo) \
+    TAU_ID_ISO_MVA(new, w) \
+    TAU_ID_ISO_MVA(new, wo) \
+    /**/
+
+namespace analysis {
+
+#define TAU_ID(name) name,
+enum class TauIdDiscriminator { TAU_IDS() };
+#undef TAU_ID
+
+namespace detail {
+// CRC-32 (the same checksum as used by tools::hash) evaluated at compile time.
+constexpr uint32_t Crc32Bits(uint32_t crc, size_t n_bits)
+{
+    return n_bits == 0 ? crc : Crc32Bits((crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u))), n_bits - 1);
+}
+
+constexpr uint32_t Crc32(const char* str, size_t length, uint32_t crc = 0xFFFFFFFFu)
+{
+    return length == 0 ? ~crc
+                       : Crc32(str + 1, length - 1, Crc32Bits(crc ^ static_cast<unsigned char>(*str), 8));
+}
+
+template<size_t N>
+constexpr uint32_t ConstexprHash(const char (&str)[N]) { return Crc32(str, N - 1); }
+} // namespace detail
+
+class TauIdRegistry {
+public:
+    using IdKey = uint32_t;
+
+#define TAU_ID(name) + 1
+    static constexpr size_t NumberOfIds = 0 TAU_IDS();
+#undef TAU_ID
+
+    static size_t Index(TauIdDiscriminator id) { return static_cast<size_t>(id); }
+
+    static IdKey Key(TauIdDiscriminator id) { return Keys().at(Index(id)); }
+
+    static const std::string& Name(TauIdDiscriminator id)
+    {
+#define TAU_ID(name) #name,
+        static const std::array<std::string, NumberOfIds> names = {{ TAU_IDS() }};
+#undef TAU_ID
+        return names.at(Index(id));
+    }
+
+    // Returns NumberOfIds if the key does not correspond to any registered discriminator.
+    static size_t FindIndex(IdKey key)
+    {
+        const auto& lookup = GetLookupTable();
+        const auto iter = std::lower_bound(lookup.begin(), lookup.end(), KeyIndexPair(key, 0));
+        if(iter == lookup.end() || iter->first != key)
+            return NumberOfIds;
+        return iter->second;
+    }
+
+    static TauIdDiscriminator AgainstElectronMVA6(DiscriminatorWP wp)
+    {
+        switch(wp) {
+            case DiscriminatorWP::VLoose: return TauIdDiscriminator::againstElectronVLooseMVA6;
+            case DiscriminatorWP::Loose: return TauIdDiscriminator::againstElectronLooseMVA6;
+            case DiscriminatorWP::Medium: return TauIdDiscriminator::againstElectronMediumMVA6;
+            case DiscriminatorWP::Tight: return TauIdDiscriminator::againstElectronTightMVA6;
+            case DiscriminatorWP::VTight: return TauIdDiscriminator::againstElectronVTightMVA6;
+            default: throw exception("TauID discriminator 'againstElectron%1%MVA6' not found.") % wp;
+        }
+    }
+
+    static TauIdDiscriminator AgainstMuon3(DiscriminatorWP wp)
+    {
+        switch(wp) {
+            case DiscriminatorWP::Loose: return TauIdDiscriminator::againstMuonLoose3;
+            case DiscriminatorWP::Tight: return TauIdDiscriminator::againstMuonTight3;
+            default: throw exception("TauID discriminator 'againstMuon%1%3' not found.") % wp;
+        }
+    }
+
+    // Discriminators of each isolation MVA flavour are registered as consecutive blocks: raw value followed by
+    // the working points from VLoose to VVTight.
+    static TauIdDiscriminator IsolationMVArun2v1DB(bool use_new_dm, bool use_lifetime, bool raw,
+                                                   DiscriminatorWP wp = DiscriminatorWP::Medium)
+    {
+        static constexpr size_t block_size = 7;
+        static_assert(static_cast<size_t>(TauIdDiscriminator::byVVTightIsolationMVArun2v1DBnewDMwoLT)
+                      - static_cast<size_t>(TauIdDiscriminator::byIsolationMVArun2v1DBoldDMwLTraw)
+                      == 4 * block_size - 1, "Unexpected layout of the isolation MVA discriminators.");
+        static const size_t first_index = Index(TauIdDiscriminator::byIsolationMVArun2v1DBoldDMwLTraw);
+        const size_t block_index = (use_new_dm ? 2 : 0) + (use_lifetime ? 0 : 1);
+        const size_t wp_index = raw ? 0 : static_cast<size_t>(wp) + 1;
+        return static_cast<TauIdDiscriminator>(first_index + block_index * block_size + wp_index);
+    }
+
+private:
+    using KeyIndexPair = std::pair<IdKey, size_t>;
+
+    static const std::array<IdKey, NumberOfIds>& Keys()
+    {
+#define TAU_ID(name) detail::ConstexprHash(#name),
+        static constexpr std::array<IdKey, NumberOfIds> keys = {{ TAU_IDS() }};
+#undef TAU_ID
+        return keys;
+    }
+
+    static const std::vector<KeyIndexPair>& GetLookupTable()
+    {
+        static const std::vector<KeyIndexPair> lookup = CreateLookupTable();
+        return lookup;
+    }
+
+    static std::vector<KeyIndexPair> CreateLookupTable()
+    {
+        std::vector<KeyIndexPair> lookup;
+        for(size_t n = 0; n < NumberOfIds; ++n) {
+            const auto id = static_cast<TauIdDiscriminator>(n);
+            if(Keys().at(n) != tools::hash(Name(id)))
+                throw exception("Inconsistent compile-time hash for the tau ID discriminator '%1%'.") % Name(id);
+            lookup.emplace_back(Keys().at(n), n);
+        }
+        std::sort(lookup.begin(), lookup.end());
+        for(size_t n = 1; n < lookup.size(); ++n) {
+            if(lookup.at(n).first == lookup.at(n - 1).first)
+                throw exception("Hash collision between the tau ID discriminators '%1%' and '%2%'.")
+                    % Name(static_cast<TauIdDiscriminator>(lookup.at(n - 1).second))
+                    % Name(static_cast<TauIdDiscriminator>(lookup.at(n).second));
+        }
+        return lookup;
+    }
+};
+
+// Values of the registered tau ID discriminators decoded from the tuple key/value branches.
+template<typename Value>
+class TauIdResults {
+public:
+    using IdKey = TauIdRegistry::IdKey;
+    static constexpr size_t NumberOfIds = TauIdRegistry::NumberOfIds;
+
+    void Decode(const std::vector<IdKey>& keys, const std::vector<Value>& values)
+    {
+        if(keys.size() != values.size())
+            throw exception("Invalid tauID data");
+        presence.reset();
+        for(size_t n = 0; n < keys.size(); ++n) {
+            const size_t index = TauIdRegistry::FindIndex(keys[n]);
+            if(index == NumberOfIds) continue;
+            results[index] = values[n];
+            presence[index] = true;
+        }
+    }
+
+    bool Get(TauIdDiscriminator id, Value& result) const
+    {
+        const size_t index = TauIdRegistry::Index(id);
+        if(!presence[index]) return false;
+        result = results[index];
+        return true;
+    }
+
+private:
+    std::array<Value, NumberOfIds> results;
+    std::bitset<NumberOfIds> presence;
+};
+
+} // namespace analysis
+
+#undef TAU_IDS
+#undef TAU_ID_ISO_MVA
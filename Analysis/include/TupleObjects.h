@@ -7,6 +7,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 #include "AnalysisMath.h"
 #include "AnalysisTypes.h"
 #include "EventTuple.h"
+#include "TauIdRegistry.h"
 
 namespace ntuple {
 
@@ -18,27 +19,27 @@ public:
     using Integer = int;
     using RealNumber = float;
 
-    TupleObject(const ntuple::Event& _event) : event(&_event) {}
+    TupleObject(const EventAccessor& _event) : event(_event) {}
 
 protected:
-    const Event* event;
+    EventAccessor event;
 };
 
 class TupleLepton : public TupleObject {
 public:    
-    TupleLepton(const ntuple::Event& _event, size_t _leg_id)
+    TupleLepton(const EventAccessor& _event, size_t _leg_id)
         : TupleObject(_event), leg_id(_leg_id)
     {
         if(leg_id < 1 || leg_id > 2)
             throw analysis::exception("Invalid leg id = %1%.") % leg_id;
     }
 
-    const LorentzVectorM& p4() const { return leg_id == 1 ? event->p4_1 : event->p4_2; }
-    Integer charge() const { return leg_id == 1 ? event->q_1 : event->q_2; }
-    RealNumber dxy() const { return leg_id == 1 ? event->dxy_1 : event->dxy_2; }
-    RealNumber dz() const { return leg_id == 1 ? event->dz_1 : event->dz_2; }
-    RealNumber iso() const { return leg_id == 1 ? event->iso_1 : event->iso_2; }
-    Integer gen_match() const { return leg_id == 1 ? event->gen_match_1 : event->gen_match_2; }
+    const LorentzVectorM& p4() const { return leg_id == 1 ? event.p4_1() : event.p4_2(); }
+    Integer charge() const { return leg_id == 1 ? event.q_1() : event.q_2(); }
+    RealNumber dxy() const { return leg_id == 1 ? event.dxy_1() : event.dxy_2(); }
+    RealNumber dz() const { return leg_id == 1 ? event.dz_1() : event.dz_2(); }
+    RealNumber iso() const { return leg_id == 1 ? event.iso_1() : event.iso_2(); }
+    Integer gen_match() const { return leg_id == 1 ? event.gen_match_1() : event.gen_match_2(); }
 
 protected:
     size_t leg_id;
@@ -46,12 +47,12 @@ protected:
 
 class TupleElectron : public TupleLepton {
 public:
-    explicit TupleElectron(const ntuple::Event& _event, size_t _leg_id = 1) : TupleLepton(_event, _leg_id) {}
+    explicit TupleElectron(const EventAccessor& _event, size_t _leg_id = 1) : TupleLepton(_event, _leg_id) {}
 };
 
 class TupleMuon : public TupleLepton {
 public:
-    explicit TupleMuon(const ntuple::Event& _event, size_t _leg_id = 1) : TupleLepton(_event, _leg_id) {}
+    explicit TupleMuon(const EventAccessor& _event, size_t _leg_id = 1) : TupleLepton(_event, _leg_id) {}
 };
 
 class TupleTau : public TupleLepton {
@@ -59,141 +60,165 @@ public:
     using IdKey = uint32_t;
     using TupleLepton::TupleLepton;
     using ValueKeyPair = std::pair<std::string, IdKey>;
+    using TauIdDiscriminator = analysis::TauIdDiscriminator;
+    using TauIdRegistry = analysis::TauIdRegistry;
 
 public:
     static ValueKeyPair GetNameKeyPair(const std::string& discriminator)
     {
-        static std::map<std::string, IdKey> hashes;
-        auto iter = hashes.find(discriminator);
-        if(iter == hashes.end()) {
-            const IdKey key = analysis::tools::hash(discriminator);
-            iter = hashes.emplace(discriminator, key).first;
-        }
-        return *iter;
+        return ValueKeyPair(discriminator, analysis::tools::hash(discriminator));
     }
 
     DiscriminatorResult tauID(const std::string& discriminator) const
     {
-        const IdKey key = GetNameKeyPair(discriminator).second;
-        return _tauID(key, discriminator);
+        const IdKey key = analysis::tools::hash(discriminator);
+        DiscriminatorResult result;
+        if(!tauID(key, result))
+            throw analysis::exception("TauID discriminator '%1%' not found.") % discriminator;
+        return result;
     }
 
     bool tauID(IdKey key, DiscriminatorResult& result) const
     {
-        if(!tauIds.size()) {
-            const auto& keys = leg_id == 1 ? event->tauId_keys_1 :event->tauId_keys_2;
-            const auto& values = leg_id == 1 ? event->tauId_values_1 :event->tauId_values_2;
-            if(keys.size() != values.size())
-                throw analysis::exception("Invalid tauID data");
-            for(size_t n = 0; n < keys.size(); ++n)
-                tauIds[keys.at(n)] = values.at(n);
-        }
-        auto result_iter = tauIds.find(key);
-        bool has_result = result_iter != tauIds.end();
-        if(has_result)
-            result = result_iter->second;
-        return has_result;
+        const size_t index = TauIdRegistry::FindIndex(key);
+        if(index != TauIdRegistry::NumberOfIds)
+            return tauID(static_cast<TauIdDiscriminator>(index), result);
+
+        const auto& keys = leg_id == 1 ? event.tauId_keys_1() : event.tauId_keys_2();
+        const auto& values = leg_id == 1 ? event.tauId_values_1() : event.tauId_values_2();
+        const auto iter = std::find(keys.begin(), keys.end(), key);
+        if(iter == keys.end()) return false;
+        result = values.at(static_cast<size_t>(std::distance(keys.begin(), iter)));
+        return true;
     }
 
-    DiscriminatorResult againstElectronMVA6(DiscriminatorWP wp) const
+    bool tauID(TauIdDiscriminator discriminator, DiscriminatorResult& result) const
     {
-        std::ostringstream ss_name;
-        ss_name << "againstElectron" << wp << "MVA6";
-        return tauID(ss_name.str());
+        if(!tauIds_decoded) {
+            const auto& keys = leg_id == 1 ? event.tauId_keys_1() : event.tauId_keys_2();
+            const auto& values = leg_id == 1 ? event.tauId_values_1() : event.tauId_values_2();
+            tauIds.Decode(keys, values);
+            tauIds_decoded = true;
+        }
+        return tauIds.Get(discriminator, result);
     }
 
-    DiscriminatorResult againstMuon3(DiscriminatorWP wp) const
+    DiscriminatorResult tauID(TauIdDiscriminator discriminator) const
     {
-        std::ostringstream ss_name;
-        ss_name << "againstMuon" << wp << "3";
-        return tauID(ss_name.str());
+        DiscriminatorResult result;
+        if(!tauID(discriminator, result))
+            throw analysis::exception("TauID discriminator '%1%' not found.") % TauIdRegistry::Name(discriminator);
+        return result;
     }
 
-    DiscriminatorResult byIsolationMVAraw(bool use_new_dm = false, bool use_lifetime = true) const
+    DiscriminatorResult againstElectronMVA6(DiscriminatorWP wp) const
     {
-        using IsoKey = std::tuple<bool, bool>;
-        static std::map<IsoKey, ValueKeyPair> keys;
-        auto iso_key = std::make_tuple(use_new_dm, use_lifetime);
-        auto iter = keys.find(iso_key);
-        if(iter == keys.end()) {
-            const std::string discriminator = GetByIsolationName(use_new_dm, use_lifetime, true);
-            iter = keys.emplace(iso_key, GetNameKeyPair(discriminator)).first;
-        }
-        return _tauID(iter->second.second, iter->second.first);
+        return tauID(TauIdRegistry::AgainstElectronMVA6(wp));
     }
 
-    bool byIsolationMVA(DiscriminatorWP wp, bool use_new_dm = false, bool use_lifetime = true) const
+    DiscriminatorResult againstMuon3(DiscriminatorWP wp) const
     {
-        using IsoKey = std::tuple<DiscriminatorWP, bool, bool>;
-        static std::map<IsoKey, ValueKeyPair> keys;
-        auto iso_key = std::make_tuple(wp, use_new_dm, use_lifetime);
-        auto iter = keys.find(iso_key);
-        if(iter == keys.end()) {
-            const std::string discriminator = GetByIsolationName(use_new_dm, use_lifetime, false, wp);
-            iter = keys.emplace(iso_key, GetNameKeyPair(discriminator)).first;
-        }
-        return _tauID(iter->second.second, iter->second.first) > 0.5;
+        return tauID(TauIdRegistry::AgainstMuon3(wp));
     }
 
-private:
-    DiscriminatorResult _tauID(IdKey key, const std::string& discriminator) const
+    DiscriminatorResult byIsolationMVAraw(bool use_new_dm = false, bool use_lifetime = true) const
     {
-        DiscriminatorResult result;
-        if(!tauID(key, result))
-            throw analysis::exception("TauID discriminator '%1%' not found.") % discriminator;
-        return result;
+        return tauID(TauIdRegistry::IsolationMVArun2v1DB(use_new_dm, use_lifetime, true));
     }
 
-    static std::string GetByIsolationName(bool use_new_dm, bool use_lifetime, bool raw,
-                                          DiscriminatorWP wp = DiscriminatorWP::Medium)
+    bool byIsolationMVA(DiscriminatorWP wp, bool use_new_dm = false, bool use_lifetime = true) const
     {
-        const std::string dm_str = use_new_dm ? "new" : "old";
-        const std::string lt_str = use_lifetime ? "w" : "wo";
-        std::ostringstream ss_name;
-        ss_name << "by";
-        if(!raw)
-            ss_name << wp;
-        ss_name << "IsolationMVArun2v1DB" << dm_str << "DM" << lt_str << "LT";
-        if(raw)
-            ss_name << "raw";
-        return ss_name.str();
+        return tauID(TauIdRegistry::IsolationMVArun2v1DB(use_new_dm, use_lifetime, false, wp)) > 0.5;
     }
 
 private:
-    mutable std::map<IdKey, DiscriminatorResult> tauIds;
+    mutable bool tauIds_decoded{false};
+    mutable analysis::TauIdResults<DiscriminatorResult> tauIds;
 };
 
 class TupleJet : public TupleObject {
 public:
-    TupleJet(const ntuple::Event& _event, size_t _jet_id)
+    TupleJet(const EventAccessor& _event, size_t _jet_id)
         : TupleObject(_event), jet_id(_jet_id)
     {
-        if(jet_id >= event->jets_p4.size())
+        if(jet_id >= event.jets_p4().size())
             throw analysis::exception("Jet id = %1% is out of range.") % jet_id;
     }
 
-    const LorentzVectorE& p4() const { return event->jets_p4.at(jet_id); }
-    DiscriminatorResult mva() const { return event->jets_mva.at(jet_id); }
-    DiscriminatorResult csv() const { return event->jets_csv.at(jet_id); }
-    Integer partonFlavour() const { return event->jets_partonFlavour.at(jet_id); }
-    Integer hadronFlavour() const { return event->jets_hadronFlavour.at(jet_id); }
-    RealNumber rawf() const { return event->jets_rawf.at(jet_id); }
+    const LorentzVectorE& p4() const { return event.jets_p4().at(jet_id); }
+    DiscriminatorResult mva() const { return event.jets_mva().at(jet_id); }
+    DiscriminatorResult csv() const { return event.jets_csv().at(jet_id); }
+    Integer partonFlavour() const { return event.jets_partonFlavour().at(jet_id); }
+    Integer hadronFlavour() const { return event.jets_hadronFlavour().at(jet_id); }
+    RealNumber rawf() const { return event.jets_rawf().at(jet_id); }
 
 private:
     size_t jet_id;
 };
 
+class TupleJetView {
+public:
+    using RealNumber = double;
+    using Integer = int;
+    using RealColumn = std::vector<RealNumber>;
+    using DiscriminatorColumn = std::vector<TupleObject::DiscriminatorResult>;
+    using IntegerColumn = std::vector<Integer>;
+
+    TupleJetView() {}
+    explicit TupleJetView(const EventAccessor& event) { Reset(event); }
+
+    // Column storage is reused between events, so no allocations are made once the capacity
+    // has reached the maximal number of jets.
+    void Reset(const EventAccessor& event)
+    {
+        const auto& p4 = event.jets_p4();
+        const auto& csv = event.jets_csv();
+        const auto& hadronFlavour = event.jets_hadronFlavour();
+        const size_t n_jets = p4.size();
+        if(csv.size() != n_jets || hadronFlavour.size() != n_jets)
+            throw analysis::exception("Inconsistent jet branches: n_p4 = %1%, n_csv = %2%, n_hadronFlavour = %3%.")
+                % n_jets % csv.size() % hadronFlavour.size();
+
+        jet_pt.resize(n_jets);
+        jet_eta.resize(n_jets);
+        jet_phi.resize(n_jets);
+        jet_energy.resize(n_jets);
+        for(size_t n = 0; n < n_jets; ++n) {
+            const analysis::LorentzVector jet_p4(p4[n]);
+            jet_pt[n] = jet_p4.Pt();
+            jet_eta[n] = jet_p4.Eta();
+            jet_phi[n] = jet_p4.Phi();
+            jet_energy[n] = jet_p4.E();
+        }
+        jet_csv.assign(csv.begin(), csv.end());
+        jet_hadronFlavour.assign(hadronFlavour.begin(), hadronFlavour.end());
+    }
+
+    size_t size() const { return jet_pt.size(); }
+    const RealColumn& pt() const { return jet_pt; }
+    const RealColumn& eta() const { return jet_eta; }
+    const RealColumn& phi() const { return jet_phi; }
+    const RealColumn& energy() const { return jet_energy; }
+    const DiscriminatorColumn& csv() const { return jet_csv; }
+    const IntegerColumn& hadronFlavour() const { return jet_hadronFlavour; }
+
+private:
+    RealColumn jet_pt, jet_eta, jet_phi, jet_energy;
+    DiscriminatorColumn jet_csv;
+    IntegerColumn jet_hadronFlavour;
+};
+
 class TupleSubJet : public TupleObject {
 public:
-    TupleSubJet(const ntuple::Event& _event, size_t _jet_id)
+    TupleSubJet(const EventAccessor& _event, size_t _jet_id)
         : TupleObject(_event), jet_id(_jet_id)
     {
-        if(jet_id >= event->subJets_p4.size())
+        if(jet_id >= event.subJets_p4().size())
             throw analysis::exception("Fat sub-jet id = %1% is out of range.") % jet_id;
     }
 
-    const LorentzVectorE& p4() const { return event->subJets_p4.at(jet_id); }
-    DiscriminatorResult csv() const { return event->subJets_csv.at(jet_id); }
+    const LorentzVectorE& p4() const { return event.subJets_p4().at(jet_id); }
+    DiscriminatorResult csv() const { return event.subJets_csv().at(jet_id); }
 
 private:
     size_t jet_id;
@@ -203,47 +228,57 @@ class TupleFatJet : public TupleObject {
 public:
     enum class MassType { Pruned, Filtered, Trimmed, SoftDrop };
 
-    TupleFatJet(const ntuple::Event& _event, size_t _jet_id)
+    TupleFatJet(const EventAccessor& _event, size_t _jet_id)
         : TupleObject(_event), jet_id(_jet_id)
     {
-        if(jet_id >= event->fatJets_p4.size())
+        if(jet_id >= event.fatJets_p4().size())
             throw analysis::exception("Fat jet id = %1% is out of range.") % jet_id;
-
-        for(size_t n = 0; n < event->subJets_p4.size(); ++n) {
-            if(event->subJets_parentIndex.at(n) == jet_id)
-                sub_jets.push_back(TupleSubJet(_event, n));
-        }
     }
 
-    const LorentzVectorE& p4() const { return event->fatJets_p4.at(jet_id); }
-    DiscriminatorResult csv() const { return event->fatJets_csv.at(jet_id); }
+    const LorentzVectorE& p4() const { return event.fatJets_p4().at(jet_id); }
+    DiscriminatorResult csv() const { return event.fatJets_csv().at(jet_id); }
 
     float m(MassType massType) const
     {
-        if(massType == MassType::Pruned) return event->fatJets_m_pruned.at(jet_id);
-        if(massType == MassType::SoftDrop) return event->fatJets_m_softDrop.at(jet_id);
+        if(massType == MassType::Pruned) return event.fatJets_m_pruned().at(jet_id);
+        if(massType == MassType::SoftDrop) return event.fatJets_m_softDrop().at(jet_id);
         throw analysis::exception("Unsupported fat jet mass type");
     }
 
     DiscriminatorResult n_subjettiness(size_t tau_index) const
     {
-        if(tau_index == 1) return event->fatJets_n_subjettiness_tau1.at(jet_id);
-        if(tau_index == 2) return event->fatJets_n_subjettiness_tau2.at(jet_id);
-        if(tau_index == 3) return event->fatJets_n_subjettiness_tau3.at(jet_id);
+        if(tau_index == 1) return event.fatJets_n_subjettiness_tau1().at(jet_id);
+        if(tau_index == 2) return event.fatJets_n_subjettiness_tau2().at(jet_id);
+        if(tau_index == 3) return event.fatJets_n_subjettiness_tau3().at(jet_id);
         throw analysis::exception("Unsupported tau index = %1% for fat jet subjettiness.") % tau_index;
     }
 
-    const std::vector<TupleSubJet>& subJets() const { return sub_jets; }
+    // Sub-jets are looked up in the event columns on each call instead of being copied into the fat jet.
+    size_t subJetCount() const
+    {
+        size_t count = 0;
+        ForEachSubJet([&](const TupleSubJet&) { ++count; });
+        return count;
+    }
+
+    template<typename Function>
+    void ForEachSubJet(Function&& function) const
+    {
+        const auto& parentIndex = event.subJets_parentIndex();
+        for(size_t n = 0; n < parentIndex.size(); ++n) {
+            if(parentIndex.at(n) == jet_id)
+                function(TupleSubJet(event, n));
+        }
+    }
 
 private:
     size_t jet_id;
-    std::vector<TupleSubJet> sub_jets;
 };
 
 class TupleMet : public TupleObject {
 public:
     using CovMatrix = analysis::SquareMatrix<2>;
-    TupleMet(const ntuple::Event& _event, MetType _met_type)
+    TupleMet(const EventAccessor& _event, MetType _met_type)
         : TupleObject(_event), met_type(_met_type)
     {
         static const std::set<MetType> supported_types = { MetType::PF, MetType::MVA, MetType::PUPPI };
@@ -255,12 +290,12 @@ public:
 
     const LorentzVectorM& p4() const
     {
-        return event->pfMET_p4;
+        return event.pfMET_p4();
     }
 
     const CovMatrix& cov() const
     {
-        return event->pfMET_cov;
+        return event.pfMET_cov();
     }
 
     RealNumber pt() const { return p4().pt(); }
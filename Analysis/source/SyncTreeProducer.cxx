@@ -1,12 +1,17 @@
 /*! Produce synchronization tree.
 This file is part of https://github.com/hh-italian-group/h-tautau. */
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <TROOT.h>
 #include "AnalysisTools/Run/include/program_main.h"
 #include "AnalysisTools/Core/include/RootExt.h"
 #include "AnalysisTools/Core/include/EnumNameMap.h"
 #include "AnalysisTools/Core/include/AnalysisMath.h"
 #include "AnalysisTools/Core/include/TextIO.h"
 #include "h-tautau/Analysis/include/SyncTupleHTT.h"
+#include "h-tautau/Analysis/include/BranchUsage.h"
 #include "h-tautau/Analysis/include/EventInfo.h"
 #include "h-tautau/Analysis/include/AnalysisTypes.h"
 #include "h-tautau/Cuts/include/Btag_2016.h"
@@ -18,6 +23,11 @@ struct Arguments {
     REQ_ARG(std::string, tree_name);
     REQ_ARG(std::string, output_file);
     OPT_ARG(std::string, sample_type, "signal");
+    OPT_ARG(unsigned, n_threads, 1);
+    OPT_ARG(unsigned, chunk_size, 10000);
+    OPT_ARG(std::string, record_manifest, "");
+    OPT_ARG(std::string, branch_manifest, "");
+    OPT_ARG(unsigned, n_manifest_check, 1000);
 };
 
 namespace analysis {
@@ -35,6 +45,7 @@ public:
     using EventTuple = ntuple::EventTuple;
     using SyncEvent = htt_sync::SyncEvent;
     using SyncTuple = htt_sync::SyncTuple;
+    using EventWeights = mc_corrections::EventWeights;
 
     static constexpr float default_value = std::numeric_limits<float>::lowest();
     static constexpr int default_int_value = std::numeric_limits<int>::lowest();
@@ -43,358 +54,569 @@ public:
     {
         std::istringstream ss_mode(args.mode());
         ss_mode >> syncMode;
+        if(!args.branch_manifest().empty())
+            enabledBranches = ntuple::ReadBranchManifest(args.branch_manifest());
     }
 
     void Run()
     {
-        static const std::map<Channel, std::vector<std::string>> triggerPaths = {
-            { Channel::ETau, { "HLT_Ele25_eta2p1_WPTight_Gsf_v" } },
-            { Channel::MuTau, { "HLT_IsoMu22_v" } },
-            { Channel::TauTau, { "HLT_DoubleMediumIsoPFTau35_Trk1_eta2p1_Reg_v" } },
-            { Channel::MuMu, { "HLT_IsoMu22_v" } },
-        };
-
         std::cout << boost::format("Processing input file '%1%' into output file '%2%' using %3% mode.\n")
                    % args.input_file() % args.output_file() % args.mode();
 
+        if(args.n_threads() > 1)
+            ROOT::EnableThreadSafety();
+
+        // Branches read by the weight providers are not seen by the recorder, so they are added explicitly.
+        std::shared_ptr<ntuple::BranchUsageRecorder> recorder;
+        if(!args.record_manifest().empty()) {
+            recorder = std::make_shared<ntuple::BranchUsageRecorder>();
+            recorder->Add(eventWeights.GetRequiredBranches({ mc_corrections::WeightType::PileUp,
+                                                             mc_corrections::WeightType::BTag }));
+        }
+
         auto originalFile = root_ext::OpenRootFile(args.input_file());
         auto outputFile = root_ext::CreateRootFile(args.output_file());
-        EventTuple originalTuple(args.tree_name(), originalFile.get(), true);
+        auto originalTuple = OpenEventTuple(originalFile.get());
         SyncTuple sync(args.tree_name(), outputFile.get(), false);
         ntuple::SummaryTuple summaryTuple("summary", originalFile.get(), true);
         summaryTuple.GetEntry(0);
-        std::shared_ptr<SummaryInfo> summaryInfo(new SummaryInfo(summaryTuple.data()));
+        const SummaryInfo summaryInfo(summaryTuple.data());
         const Channel channel = Parse<Channel>(args.tree_name());
-        const Long64_t n_entries = originalTuple.GetEntries();
-        for(Long64_t current_entry = 0; current_entry < n_entries; ++current_entry) {
+        const Long64_t n_entries = originalTuple->GetEntries();
+        const Long64_t n_threads = std::max<Long64_t>(std::min<Long64_t>(args.n_threads(), n_entries), 1);
+
+        if(!enabledBranches.empty() && args.n_manifest_check())
+            CheckBranchManifest(*originalTuple, channel, summaryInfo, sync());
+
+        if(n_threads == 1) {
+            ProcessEntries(*originalTuple, 0, n_entries, channel, summaryInfo, eventWeights, sync(),
+                           [&]() { sync.Fill(); });
+        } else {
+            ProcessEntriesInParallel(n_entries, static_cast<size_t>(n_threads), channel, summaryInfo, sync);
+        }
+
+        sync.Write();
+        if(recorder) {
+            recorder->WriteManifest(args.record_manifest());
+            std::cout << boost::format("Branch manifest with %1% branches is written into '%2%'.\n")
+                         % recorder->GetBranches().size() % args.record_manifest();
+        }
+    }
+
+private:
+    // Jet collections filled for each event. They are owned by the caller of FillSyncEvent, so that their storage is
+    // reused between the events processed by the same thread.
+    struct SelectedJets {
+        EventInfoBase::JetCollection jets_pt20, jets_pt30, bjets_pt, bjets_csv;
+    };
+
+    // If the branch manifest is provided, only the branches listed in it are read.
+    std::shared_ptr<EventTuple> OpenEventTuple(TFile* file, bool use_manifest = true) const
+    {
+        ntuple::EventTupleOptions options;
+        if(use_manifest)
+            options.enabled_branches = enabledBranches;
+        return ntuple::CreateEventTuple(args.tree_name(), file, true, ntuple::TreeState::Full, options);
+    }
+
+    // Branches that are used but not listed in the manifest are not read and keep the default values. To detect
+    // this, the first n_manifest_check entries are processed with all branches and with the manifest branches only,
+    // and the produced sync events are compared.
+    void CheckBranchManifest(EventTuple& manifestTuple, Channel channel, const SummaryInfo& summaryInfo,
+                             const SyncEvent& emptySyncEvent) const
+    {
+        auto fullFile = root_ext::OpenRootFile(args.input_file());
+        auto fullTuple = OpenEventTuple(fullFile.get(), false);
+        const Long64_t n_entries = std::min<Long64_t>(fullTuple->GetEntries(), args.n_manifest_check());
+
+        SyncEvent syncEvent(emptySyncEvent);
+        std::vector<SyncEvent> fullOutput, manifestOutput;
+        ProcessEntries(*fullTuple, 0, n_entries, channel, summaryInfo, eventWeights, syncEvent,
+                       [&]() { fullOutput.push_back(syncEvent); });
+        ProcessEntries(manifestTuple, 0, n_entries, channel, summaryInfo, eventWeights, syncEvent,
+                       [&]() { manifestOutput.push_back(syncEvent); });
+
+        if(manifestOutput.size() != fullOutput.size())
+            throw exception("Branch manifest '%1%' is incomplete: %2% events are selected from the first %3% entries"
+                            " with all branches and %4% events with the manifest branches only.")
+                % args.branch_manifest() % fullOutput.size() % n_entries % manifestOutput.size();
+        for(size_t n = 0; n < fullOutput.size(); ++n) {
+            const auto branches = htt_sync::FindDifferentBranches(fullOutput.at(n), manifestOutput.at(n));
+            if(branches.empty()) continue;
+            std::ostringstream ss;
+            for(const auto& branch : branches)
+                ss << " " << branch;
+            throw exception("Branch manifest '%1%' is incomplete: sync branches of event %2%:%3%:%4% are different"
+                            " with the manifest branches only:%5%.") % args.branch_manifest() % fullOutput.at(n).run
+                % fullOutput.at(n).lumi % fullOutput.at(n).evt % ss.str();
+        }
+        std::cout << boost::format("Branch manifest '%1%' is validated on the first %2% entries.\n")
+                     % args.branch_manifest() % n_entries;
+    }
+
+    // Entries are split into chunks of chunk_size entries. Workers process the chunks through independent file
+    // handles and buffer the selected events of each chunk, while the main thread writes the completed chunks in the
+    // original entry order, so the output is identical to the one produced by the serial loop. Workers don't start
+    // a new chunk if 2 * n_threads chunks are already waiting to be written, which limits the memory usage. Weight
+    // providers are not thread-safe, so each worker owns a separate copy of them.
+    void ProcessEntriesInParallel(Long64_t n_entries, size_t n_threads, Channel channel,
+                                  const SummaryInfo& summaryInfo, SyncTuple& sync) const
+    {
+        const Long64_t chunk_size = std::max<Long64_t>(args.chunk_size(), 1);
+        const size_t n_chunks = static_cast<size_t>((n_entries + chunk_size - 1) / chunk_size);
+        const size_t max_pending_chunks = 2 * n_threads;
+        const SyncEvent emptySyncEvent(sync());
+
+        std::mutex mutex;
+        std::condition_variable cond_var;
+        std::map<size_t, std::vector<SyncEvent>> completed_chunks;
+        size_t next_chunk = 0, n_written_chunks = 0;
+        std::exception_ptr error;
+
+        const auto SetError = [&](std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(!error)
+                    error = e;
+            }
+            cond_var.notify_all();
+        };
+
+        std::vector<std::thread> workers;
+        for(size_t n = 0; n < n_threads; ++n) {
+            workers.emplace_back([&]() {
+                try {
+                    auto workerFile = root_ext::OpenRootFile(args.input_file());
+                    auto workerTuple = OpenEventTuple(workerFile.get());
+                    EventWeights workerWeights(Period::Run2016, DiscriminatorWP::Medium);
+                    SyncEvent syncEvent(emptySyncEvent);
+                    while(true) {
+                        size_t chunk_id;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            cond_var.wait(lock, [&]() {
+                                return error || next_chunk >= n_chunks
+                                    || next_chunk < n_written_chunks + max_pending_chunks;
+                            });
+                            if(error || next_chunk >= n_chunks) return;
+                            chunk_id = next_chunk++;
+                        }
+                        const Long64_t first_entry = static_cast<Long64_t>(chunk_id) * chunk_size;
+                        const Long64_t last_entry = std::min(first_entry + chunk_size, n_entries);
+                        std::vector<SyncEvent> output;
+                        ProcessEntries(*workerTuple, first_entry, last_entry, channel, summaryInfo, workerWeights,
+                                       syncEvent, [&]() { output.push_back(syncEvent); });
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            completed_chunks[chunk_id] = std::move(output);
+                        }
+                        cond_var.notify_all();
+                    }
+                } catch(...) {
+                    SetError(std::current_exception());
+                }
+            });
+        }
+
+        try {
+            while(true) {
+                std::vector<SyncEvent> chunk;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond_var.wait(lock, [&]() {
+                        return error || n_written_chunks >= n_chunks || completed_chunks.count(n_written_chunks);
+                    });
+                    if(error || n_written_chunks >= n_chunks) break;
+                    auto iter = completed_chunks.find(n_written_chunks);
+                    chunk = std::move(iter->second);
+                    completed_chunks.erase(iter);
+                }
+                for(const SyncEvent& syncEvent : chunk) {
+                    sync() = syncEvent;
+                    sync.Fill();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++n_written_chunks;
+                }
+                cond_var.notify_all();
+            }
+        } catch(...) {
+            SetError(std::current_exception());
+        }
+
+        for(auto& worker : workers)
+            worker.join();
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    template<typename Output>
+    void ProcessEntries(EventTuple& originalTuple, Long64_t first_entry, Long64_t last_entry, Channel channel,
+                        const SummaryInfo& summaryInfo, const EventWeights& weights, SyncEvent& syncEvent,
+                        Output&& output) const
+    {
+        static const std::map<Channel, std::vector<std::string>> triggerPaths = {
+            { Channel::ETau, { "HLT_Ele25_eta2p1_WPTight_Gsf_v" } },
+            { Channel::MuTau, { "HLT_IsoMu22_v" } },
+            { Channel::TauTau, { "HLT_DoubleMediumIsoPFTau35_Trk1_eta2p1_Reg_v" } },
+            { Channel::MuMu, { "HLT_IsoMu22_v" } },
+        };
+
+        std::shared_ptr<EventInfoBase> eventInfoPtr;
+        SelectedJets selectedJets;
+        for(Long64_t current_entry = first_entry; current_entry < last_entry; ++current_entry) {
             originalTuple.GetEntry(current_entry);
-            const auto bjet_pair = EventInfoBase::SelectBjetPair(originalTuple.data(), cuts::btag_2016::pt,
+            // Entries for the shifted energy scales are partially stored and are not used for the synchronization.
+            if(static_cast<EventEnergyScale>(originalTuple.data().eventEnergyScale) != EventEnergyScale::Central)
+                continue;
+            const ntuple::EventAccessor tupleEvent(originalTuple.data());
+            const auto bjet_pair = EventInfoBase::SelectBjetPair(tupleEvent, cuts::btag_2016::pt,
                                                                  cuts::btag_2016::eta, JetOrdering::CSV);
-            auto eventInfoPtr = MakeEventInfo(channel, originalTuple.data(), bjet_pair, summaryInfo.get());
+            if(!eventInfoPtr)
+                eventInfoPtr = MakeEventInfo(channel, tupleEvent, bjet_pair, &summaryInfo);
+            else
+                eventInfoPtr->Reset(tupleEvent, bjet_pair);
             EventInfoBase& event = *eventInfoPtr;
-            if(event.GetEnergyScale() != EventEnergyScale::Central) continue;
             if(args.sample_type() == "data" && !event.GetTriggerResults().AnyAcceptAndMatch(triggerPaths.at(channel)))
                 continue;
 
             if(syncMode == SyncMode::HH) {
-                if(/*event->dilepton_veto ||*/ event->extraelec_veto || event->extramuon_veto) continue;
+                if(/*tupleEvent.dilepton_veto() ||*/ tupleEvent.extraelec_veto() || tupleEvent.extramuon_veto())
+                    continue;
             }
 
-            const auto GetTauID = [&](size_t leg_id, const std::string& id_name) -> float {
-                const auto& id_keys = leg_id == 1 ? event->tauId_keys_1 : event->tauId_keys_2;
-                const auto& id_values = leg_id == 1 ? event->tauId_values_1 : event->tauId_values_2;
-                const uint32_t key = tools::hash(id_name);
-                const auto iter = std::find(id_keys.begin(), id_keys.end(), key);
-                if(iter == id_keys.end()) return default_value;
-                const size_t index = static_cast<size_t>(std::distance(id_keys.begin(), iter));
-                return id_values.at(index);
-            };
-
-
-            sync().run = event->run;
-            sync().lumi = event->lumi;
-            sync().evt = event->evt;
-            // sync().rho = ;
-            sync().npv = event->npv;
-            sync().npu = event->npu;
-
-            sync().pt_1 = event->p4_1.Pt();
-            sync().phi_1 = event->p4_1.Phi();
-            sync().eta_1 = event->p4_1.Eta();
-            sync().m_1 = event->p4_1.mass();
-            sync().q_1 = event->q_1;
-            sync().d0_1 = event->dxy_1;
-            sync().dZ_1 = event->dz_1;
-//            sync().mt_1 = Calculate_MT(event->p4_1, event->mvaMET_p4);
-            sync().pfmt_1 = static_cast<float>(Calculate_MT(event->p4_1, event->pfMET_p4));
-//            sync().puppimt_1 = Calculate_MT(event->p4_1, event->pfMET_p4);
-            sync().iso_1 =  event->iso_1;
-//            sync().id_e_mva_nt_loose_1 = event->id_e_mva_nt_loose_1;
-            sync().gen_match_1 = event->gen_match_1;
-            sync().againstElectronLooseMVA6_1 = GetTauID(1, "againstElectronLooseMVA6");
-            sync().againstElectronMediumMVA6_1 = GetTauID(1, "againstElectronMediumMVA6");
-            sync().againstElectronTightMVA6_1 = GetTauID(1, "againstElectronTightMVA6");
-            sync().againstElectronVLooseMVA6_1 = GetTauID(1, "againstElectronVLooseMVA6");
-            sync().againstElectronVTightMVA6_1 = GetTauID(1, "againstElectronVTightMVA6");
-            sync().againstMuonLoose3_1 = GetTauID(1, "againstMuonLoose3");
-            sync().againstMuonTight3_1 = GetTauID(1, "againstMuonTight3");
-            sync().byCombinedIsolationDeltaBetaCorrRaw3Hits_1 = GetTauID(1, "byCombinedIsolationDeltaBetaCorrRaw3Hits");
-            sync().byIsolationMVA3newDMwoLTraw_1 = GetTauID(1, "byIsolationMVA3newDMwoLTraw");
-            sync().byIsolationMVA3oldDMwoLTraw_1 = GetTauID(1, "byIsolationMVA3oldDMwoLTraw");
-            sync().byIsolationMVA3newDMwLTraw_1 = GetTauID(1, "byIsolationMVA3newDMwLTraw");
-            sync().byIsolationMVA3oldDMwLTraw_1 = GetTauID(1, "byIsolationMVA3oldDMwLTraw");
-            //sync().chargedIsoPtSum_1 = ;
-            sync().decayModeFindingOldDMs_1 = GetTauID(1, "decayModeFindingOldDMs");
-            // sync().neutralIsoPtSum_1 = ;
-            // sync().puCorrPtSum_1 = ;
-            // sync().trigweight_1 = ;
-            // sync().idisoweight_1 = ;
-
-            sync().pt_2 = event->p4_2.Pt();
-            sync().phi_2 = event->p4_2.Phi();
-            sync().eta_2 = event->p4_2.Eta();
-            sync().m_2 = event->p4_2.mass();
-            sync().q_2 = event->q_2;
-            sync().d0_2 = event->dxy_2;
-            sync().dZ_2 = event->dz_2;
-//            sync().mt_2 = Calculate_MT(event->p4_2, event->mvaMET_p4);
-            sync().pfmt_2 = static_cast<float>(Calculate_MT(event->p4_2, event->pfMET_p4));
-//            sync().puppimt_2 = Calculate_MT(event->p4_2, event->pfMET_p4);
-            sync().iso_2 =  event->iso_2;
-//            sync().id_e_mva_nt_loose_2 = event->id_e_mva_nt_loose_2;
-            sync().gen_match_2 = event->gen_match_2;
-            sync().againstElectronLooseMVA6_2 = GetTauID(2, "againstElectronLooseMVA6");
-            sync().againstElectronMediumMVA6_2 = GetTauID(2, "againstElectronMediumMVA6");
-            sync().againstElectronTightMVA6_2 = GetTauID(2, "againstElectronTightMVA6");
-            sync().againstElectronVLooseMVA6_2 = GetTauID(2, "againstElectronVLooseMVA6");
-            sync().againstElectronVTightMVA6_2 = GetTauID(2, "againstElectronVTightMVA6");
-            sync().againstMuonLoose3_2 = GetTauID(2, "againstMuonLoose3");
-            sync().againstMuonTight3_2 = GetTauID(2, "againstMuonTight3");
-            sync().byCombinedIsolationDeltaBetaCorrRaw3Hits_2 = GetTauID(2, "byCombinedIsolationDeltaBetaCorrRaw3Hits");
-            sync().byIsolationMVA3newDMwoLTraw_2 = GetTauID(2, "byIsolationMVA3newDMwoLTraw");
-            sync().byIsolationMVA3oldDMwoLTraw_2 = GetTauID(2, "byIsolationMVA3oldDMwoLTraw");
-            sync().byIsolationMVA3newDMwLTraw_2 = GetTauID(2, "byIsolationMVA3newDMwLTraw");
-            sync().byIsolationMVA3oldDMwLTraw_2 = GetTauID(2, "byIsolationMVA3oldDMwLTraw");
-            //sync().chargedIsoPtSum_2 = ;
-            sync().decayModeFindingOldDMs_2 = GetTauID(2, "decayModeFindingOldDMs");
-            // sync().neutralIsoPtSum_2 = ;
-            // sync().puCorrPtSum_2 = ;
-            // sync().trigweight_2 = ;
-            // sync().idisoweight_2 = ;
-
-            sync().pt_tt = (event->p4_1 + event->p4_2 + event->pfMET_p4).Pt();
-//            sync().mt_tot = Calculate_TotalMT(event->p4_1, event->p4_2, event->mvaMET_p4);
-            sync().m_vis = (event->p4_1 + event->p4_2).M();
-            sync().m_sv = event->SVfit_p4.M();
-            sync().mt_sv = event->SVfit_mt;
-
-            sync().met = event->pfMET_p4.Pt();
-            if(syncMode == SyncMode::HH) sync().metphi = static_cast<float>(TVector2::Phi_0_2pi(event->pfMET_p4.Phi()));
-            else sync().metphi = static_cast<float>(TVector2::Phi_mpi_pi(event->pfMET_p4.Phi()));
-//            sync().puppimet = event->puppiMET_p4.Pt();
-//            sync().puppimetphi = event->puppiMET_p4.Phi();
-//            sync().mvamet = event->mvaMET_p4.Pt();
-//            sync().mvametphi = event->mvaMET_p4.Phi();
-            sync().pzetavis = static_cast<float>(Calculate_visiblePzeta(event->p4_1, event->p4_2));
-//            sync().pzetamiss = Calculate_Pzeta(event->p4_1, event->p4_2, event->mvaMET_p4);
-//            sync().mvacov00 = event->mvaMET_cov[0][0];
-//            sync().mvacov01 = event->mvaMET_cov[0][1];
-//            sync().mvacov10 = event->mvaMET_cov[1][0];
-//            sync().mvacov11 = event->mvaMET_cov[1][1];
-            sync().metcov00 = static_cast<float>(event->pfMET_cov[0][0]);
-            sync().metcov01 = static_cast<float>(event->pfMET_cov[0][1]);
-            sync().metcov10 = static_cast<float>(event->pfMET_cov[1][0]);
-            sync().metcov11 = static_cast<float>(event->pfMET_cov[1][1]);
-
-            const auto jets_pt20 = event.SelectJets(20, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
-            const auto jets_pt30 = event.SelectJets(30, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
-            const auto bjets_pt = event.SelectJets(cuts::btag_2016::pt, cuts::btag_2016::eta, cuts::btag_2016::CSVv2M, JetOrdering::Pt);
-            const auto bjets_csv = event.SelectJets(cuts::btag_2016::pt,cuts::btag_2016::eta,std::numeric_limits<double>::lowest(), JetOrdering::CSV);
-
-            if(jets_pt20.size() >= 2) {
-                sync().mjj = static_cast<float>((jets_pt20.at(0).GetMomentum() + jets_pt20.at(1).GetMomentum()).M());
-                sync().jdeta = static_cast<float>(jets_pt20.at(0).GetMomentum().Eta()
-                                                  - jets_pt20.at(1).GetMomentum().Eta());
-                //sync().njetingap = ;
-                //sync().njetingap20 = ;
-                sync().jdphi = static_cast<float>(TVector2::Phi_mpi_pi(jets_pt20.at(0).GetMomentum().Phi()
-                                                                       - jets_pt20.at(1).GetMomentum().Phi()));
-            } else {
-                sync().mjj = default_value;
-                sync().jdeta = default_value;
-                //sync().njetingap = default_value;
-                //sync().njetingap20 = default_value;
-                sync().jdphi = default_value;
-            }
+            FillSyncEvent(event, weights, selectedJets, syncEvent);
+            output();
+        }
+    }
 
-            sync().nbtag = static_cast<int>(bjets_pt.size());
-            sync().njets = static_cast<int>(jets_pt30.size());
-            sync().njetspt20 = static_cast<int>(jets_pt20.size());
-            if(jets_pt20.size() >= 1) {
-                sync().jpt_1 = static_cast<float>(jets_pt20.at(0).GetMomentum().Pt());
-                sync().jeta_1 = static_cast<float>(jets_pt20.at(0).GetMomentum().Eta());
-                sync().jphi_1 = static_cast<float>(jets_pt20.at(0).GetMomentum().Phi());
-                sync().jrawf_1 = jets_pt20.at(0)->rawf();
-                sync().jmva_1 = jets_pt20.at(0)->mva();
-            } else {
-                sync().jpt_1 = default_value;
-                sync().jeta_1 = default_value;
-                sync().jphi_1 = default_value;
-                sync().jrawf_1 = default_value;
-                sync().jmva_1 = default_value;
-            }
-            if(jets_pt20.size() >= 2) {
-                sync().jpt_2 = static_cast<float>(jets_pt20.at(1).GetMomentum().Pt());
-                sync().jeta_2 = static_cast<float>(jets_pt20.at(1).GetMomentum().Eta());
-                sync().jphi_2 = static_cast<float>(jets_pt20.at(1).GetMomentum().Phi());
-                sync().jrawf_2 = jets_pt20.at(1)->rawf();
-                sync().jmva_2 = jets_pt20.at(1)->mva();
-            } else {
-                sync().jpt_2 = default_value;
-                sync().jeta_2 = default_value;
-                sync().jphi_2 = default_value;
-                sync().jrawf_2 = default_value;
-                sync().jmva_2 = default_value;
-            }
-            if(bjets_pt.size() >= 1) {
-                sync().bpt_1 = static_cast<float>(bjets_pt.at(0).GetMomentum().Pt());
-                sync().beta_1 = static_cast<float>(bjets_pt.at(0).GetMomentum().Eta());
-                sync().bphi_1 = static_cast<float>(bjets_pt.at(0).GetMomentum().Phi());
-                sync().brawf_1 = bjets_pt.at(0)->rawf();
-                sync().bmva_1 = bjets_pt.at(0)->mva();
-                sync().bcsv_1 = bjets_pt.at(0)->csv();
+    void FillSyncEvent(EventInfoBase& event, const EventWeights& weights, SelectedJets& selectedJets,
+                       SyncEvent& syncEvent) const
+    {
+        // Event branches are read through the accessor, so that they are seen by the branch usage recorder.
+        const ntuple::EventAccessor& tupleEvent = event.GetEventAccessor();
+        const ntuple::TupleTau tau_1(tupleEvent, 1), tau_2(tupleEvent, 2);
+        const auto GetTauID = [&](size_t leg_id, TauIdDiscriminator id) -> float {
+            const ntuple::TupleTau& tau = leg_id == 1 ? tau_1 : tau_2;
+            ntuple::TupleTau::DiscriminatorResult result;
+            return tau.tauID(id, result) ? result : default_value;
+        };
+
+
+        syncEvent.run = tupleEvent.run();
+        syncEvent.lumi = tupleEvent.lumi();
+        syncEvent.evt = tupleEvent.evt();
+        // syncEvent.rho = ;
+        syncEvent.npv = tupleEvent.npv();
+        syncEvent.npu = tupleEvent.npu();
+
+        syncEvent.pt_1 = tupleEvent.p4_1().Pt();
+        syncEvent.phi_1 = tupleEvent.p4_1().Phi();
+        syncEvent.eta_1 = tupleEvent.p4_1().Eta();
+        syncEvent.m_1 = tupleEvent.p4_1().mass();
+        syncEvent.q_1 = tupleEvent.q_1();
+        syncEvent.d0_1 = tupleEvent.dxy_1();
+        syncEvent.dZ_1 = tupleEvent.dz_1();
+//            syncEvent.mt_1 = Calculate_MT(tupleEvent.p4_1(), tupleEvent.mvaMET_p4());
+        syncEvent.pfmt_1 = static_cast<float>(Calculate_MT(tupleEvent.p4_1(), tupleEvent.pfMET_p4()));
+//            syncEvent.puppimt_1 = Calculate_MT(tupleEvent.p4_1(), tupleEvent.pfMET_p4());
+        syncEvent.iso_1 =  tupleEvent.iso_1();
+//            syncEvent.id_e_mva_nt_loose_1 = tupleEvent.id_e_mva_nt_loose_1();
+        syncEvent.gen_match_1 = tupleEvent.gen_match_1();
+        syncEvent.againstElectronLooseMVA6_1 = GetTauID(1, TauIdDiscriminator::againstElectronLooseMVA6);
+        syncEvent.againstElectronMediumMVA6_1 = GetTauID(1, TauIdDiscriminator::againstElectronMediumMVA6);
+        syncEvent.againstElectronTightMVA6_1 = GetTauID(1, TauIdDiscriminator::againstElectronTightMVA6);
+        syncEvent.againstElectronVLooseMVA6_1 = GetTauID(1, TauIdDiscriminator::againstElectronVLooseMVA6);
+        syncEvent.againstElectronVTightMVA6_1 = GetTauID(1, TauIdDiscriminator::againstElectronVTightMVA6);
+        syncEvent.againstMuonLoose3_1 = GetTauID(1, TauIdDiscriminator::againstMuonLoose3);
+        syncEvent.againstMuonTight3_1 = GetTauID(1, TauIdDiscriminator::againstMuonTight3);
+        syncEvent.byCombinedIsolationDeltaBetaCorrRaw3Hits_1 =
+                GetTauID(1, TauIdDiscriminator::byCombinedIsolationDeltaBetaCorrRaw3Hits);
+        syncEvent.byIsolationMVA3newDMwoLTraw_1 = GetTauID(1, TauIdDiscriminator::byIsolationMVA3newDMwoLTraw);
+        syncEvent.byIsolationMVA3oldDMwoLTraw_1 = GetTauID(1, TauIdDiscriminator::byIsolationMVA3oldDMwoLTraw);
+        syncEvent.byIsolationMVA3newDMwLTraw_1 = GetTauID(1, TauIdDiscriminator::byIsolationMVA3newDMwLTraw);
+        syncEvent.byIsolationMVA3oldDMwLTraw_1 = GetTauID(1, TauIdDiscriminator::byIsolationMVA3oldDMwLTraw);
+        //syncEvent.chargedIsoPtSum_1 = ;
+        syncEvent.decayModeFindingOldDMs_1 = GetTauID(1, TauIdDiscriminator::decayModeFindingOldDMs);
+        // syncEvent.neutralIsoPtSum_1 = ;
+        // syncEvent.puCorrPtSum_1 = ;
+        // syncEvent.trigweight_1 = ;
+        // syncEvent.idisoweight_1 = ;
+
+        syncEvent.pt_2 = tupleEvent.p4_2().Pt();
+        syncEvent.phi_2 = tupleEvent.p4_2().Phi();
+        syncEvent.eta_2 = tupleEvent.p4_2().Eta();
+        syncEvent.m_2 = tupleEvent.p4_2().mass();
+        syncEvent.q_2 = tupleEvent.q_2();
+        syncEvent.d0_2 = tupleEvent.dxy_2();
+        syncEvent.dZ_2 = tupleEvent.dz_2();
+//            syncEvent.mt_2 = Calculate_MT(tupleEvent.p4_2(), tupleEvent.mvaMET_p4());
+        syncEvent.pfmt_2 = static_cast<float>(Calculate_MT(tupleEvent.p4_2(), tupleEvent.pfMET_p4()));
+//            syncEvent.puppimt_2 = Calculate_MT(tupleEvent.p4_2(), tupleEvent.pfMET_p4());
+        syncEvent.iso_2 =  tupleEvent.iso_2();
+//            syncEvent.id_e_mva_nt_loose_2 = tupleEvent.id_e_mva_nt_loose_2();
+        syncEvent.gen_match_2 = tupleEvent.gen_match_2();
+        syncEvent.againstElectronLooseMVA6_2 = GetTauID(2, TauIdDiscriminator::againstElectronLooseMVA6);
+        syncEvent.againstElectronMediumMVA6_2 = GetTauID(2, TauIdDiscriminator::againstElectronMediumMVA6);
+        syncEvent.againstElectronTightMVA6_2 = GetTauID(2, TauIdDiscriminator::againstElectronTightMVA6);
+        syncEvent.againstElectronVLooseMVA6_2 = GetTauID(2, TauIdDiscriminator::againstElectronVLooseMVA6);
+        syncEvent.againstElectronVTightMVA6_2 = GetTauID(2, TauIdDiscriminator::againstElectronVTightMVA6);
+        syncEvent.againstMuonLoose3_2 = GetTauID(2, TauIdDiscriminator::againstMuonLoose3);
+        syncEvent.againstMuonTight3_2 = GetTauID(2, TauIdDiscriminator::againstMuonTight3);
+        syncEvent.byCombinedIsolationDeltaBetaCorrRaw3Hits_2 =
+                GetTauID(2, TauIdDiscriminator::byCombinedIsolationDeltaBetaCorrRaw3Hits);
+        syncEvent.byIsolationMVA3newDMwoLTraw_2 = GetTauID(2, TauIdDiscriminator::byIsolationMVA3newDMwoLTraw);
+        syncEvent.byIsolationMVA3oldDMwoLTraw_2 = GetTauID(2, TauIdDiscriminator::byIsolationMVA3oldDMwoLTraw);
+        syncEvent.byIsolationMVA3newDMwLTraw_2 = GetTauID(2, TauIdDiscriminator::byIsolationMVA3newDMwLTraw);
+        syncEvent.byIsolationMVA3oldDMwLTraw_2 = GetTauID(2, TauIdDiscriminator::byIsolationMVA3oldDMwLTraw);
+        //syncEvent.chargedIsoPtSum_2 = ;
+        syncEvent.decayModeFindingOldDMs_2 = GetTauID(2, TauIdDiscriminator::decayModeFindingOldDMs);
+        // syncEvent.neutralIsoPtSum_2 = ;
+        // syncEvent.puCorrPtSum_2 = ;
+        // syncEvent.trigweight_2 = ;
+        // syncEvent.idisoweight_2 = ;
+
+        syncEvent.pt_tt = (tupleEvent.p4_1() + tupleEvent.p4_2() + tupleEvent.pfMET_p4()).Pt();
+//            syncEvent.mt_tot = Calculate_TotalMT(tupleEvent.p4_1(), tupleEvent.p4_2(), tupleEvent.mvaMET_p4());
+        syncEvent.m_vis = (tupleEvent.p4_1() + tupleEvent.p4_2()).M();
+        syncEvent.m_sv = tupleEvent.SVfit_p4().M();
+        syncEvent.mt_sv = tupleEvent.SVfit_mt();
+
+        syncEvent.met = tupleEvent.pfMET_p4().Pt();
+        const double met_phi = tupleEvent.pfMET_p4().Phi();
+        if(syncMode == SyncMode::HH) syncEvent.metphi = static_cast<float>(TVector2::Phi_0_2pi(met_phi));
+        else syncEvent.metphi = static_cast<float>(TVector2::Phi_mpi_pi(met_phi));
+//            syncEvent.puppimet = tupleEvent.puppiMET_p4().Pt();
+//            syncEvent.puppimetphi = tupleEvent.puppiMET_p4().Phi();
+//            syncEvent.mvamet = tupleEvent.mvaMET_p4().Pt();
+//            syncEvent.mvametphi = tupleEvent.mvaMET_p4().Phi();
+        syncEvent.pzetavis = static_cast<float>(Calculate_visiblePzeta(tupleEvent.p4_1(), tupleEvent.p4_2()));
+//            syncEvent.pzetamiss = Calculate_Pzeta(tupleEvent.p4_1(), tupleEvent.p4_2(), tupleEvent.mvaMET_p4());
+//            syncEvent.mvacov00 = tupleEvent.mvaMET_cov()[0][0];
+//            syncEvent.mvacov01 = tupleEvent.mvaMET_cov()[0][1];
+//            syncEvent.mvacov10 = tupleEvent.mvaMET_cov()[1][0];
+//            syncEvent.mvacov11 = tupleEvent.mvaMET_cov()[1][1];
+        syncEvent.metcov00 = static_cast<float>(tupleEvent.pfMET_cov()[0][0]);
+        syncEvent.metcov01 = static_cast<float>(tupleEvent.pfMET_cov()[0][1]);
+        syncEvent.metcov10 = static_cast<float>(tupleEvent.pfMET_cov()[1][0]);
+        syncEvent.metcov11 = static_cast<float>(tupleEvent.pfMET_cov()[1][1]);
+
+        const auto& jets_pt20 = selectedJets.jets_pt20;
+        const auto& jets_pt30 = selectedJets.jets_pt30;
+        const auto& bjets_pt = selectedJets.bjets_pt;
+        const auto& bjets_csv = selectedJets.bjets_csv;
+        event.SelectJets(selectedJets.jets_pt20, 20, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
+        event.SelectJets(selectedJets.jets_pt30, 30, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
+        event.SelectJets(selectedJets.bjets_pt, cuts::btag_2016::pt, cuts::btag_2016::eta, cuts::btag_2016::CSVv2M,
+                         JetOrdering::Pt);
+        event.SelectJets(selectedJets.bjets_csv, cuts::btag_2016::pt, cuts::btag_2016::eta,
+                         std::numeric_limits<double>::lowest(), JetOrdering::CSV);
+
+        if(jets_pt20.size() >= 2) {
+            syncEvent.mjj = static_cast<float>((jets_pt20.at(0).GetMomentum() + jets_pt20.at(1).GetMomentum()).M());
+            syncEvent.jdeta = static_cast<float>(jets_pt20.at(0).GetMomentum().Eta()
+                                              - jets_pt20.at(1).GetMomentum().Eta());
+            //syncEvent.njetingap = ;
+            //syncEvent.njetingap20 = ;
+            syncEvent.jdphi = static_cast<float>(TVector2::Phi_mpi_pi(jets_pt20.at(0).GetMomentum().Phi()
+                                                                   - jets_pt20.at(1).GetMomentum().Phi()));
+        } else {
+            syncEvent.mjj = default_value;
+            syncEvent.jdeta = default_value;
+            //syncEvent.njetingap = default_value;
+            //syncEvent.njetingap20 = default_value;
+            syncEvent.jdphi = default_value;
+        }
+
+        syncEvent.nbtag = static_cast<int>(bjets_pt.size());
+        syncEvent.njets = static_cast<int>(jets_pt30.size());
+        syncEvent.njetspt20 = static_cast<int>(jets_pt20.size());
+        if(jets_pt20.size() >= 1) {
+            syncEvent.jpt_1 = static_cast<float>(jets_pt20.at(0).GetMomentum().Pt());
+            syncEvent.jeta_1 = static_cast<float>(jets_pt20.at(0).GetMomentum().Eta());
+            syncEvent.jphi_1 = static_cast<float>(jets_pt20.at(0).GetMomentum().Phi());
+            syncEvent.jrawf_1 = jets_pt20.at(0)->rawf();
+            syncEvent.jmva_1 = jets_pt20.at(0)->mva();
+        } else {
+            syncEvent.jpt_1 = default_value;
+            syncEvent.jeta_1 = default_value;
+            syncEvent.jphi_1 = default_value;
+            syncEvent.jrawf_1 = default_value;
+            syncEvent.jmva_1 = default_value;
+        }
+        if(jets_pt20.size() >= 2) {
+            syncEvent.jpt_2 = static_cast<float>(jets_pt20.at(1).GetMomentum().Pt());
+            syncEvent.jeta_2 = static_cast<float>(jets_pt20.at(1).GetMomentum().Eta());
+            syncEvent.jphi_2 = static_cast<float>(jets_pt20.at(1).GetMomentum().Phi());
+            syncEvent.jrawf_2 = jets_pt20.at(1)->rawf();
+            syncEvent.jmva_2 = jets_pt20.at(1)->mva();
+        } else {
+            syncEvent.jpt_2 = default_value;
+            syncEvent.jeta_2 = default_value;
+            syncEvent.jphi_2 = default_value;
+            syncEvent.jrawf_2 = default_value;
+            syncEvent.jmva_2 = default_value;
+        }
+        if(bjets_pt.size() >= 1) {
+            syncEvent.bpt_1 = static_cast<float>(bjets_pt.at(0).GetMomentum().Pt());
+            syncEvent.beta_1 = static_cast<float>(bjets_pt.at(0).GetMomentum().Eta());
+            syncEvent.bphi_1 = static_cast<float>(bjets_pt.at(0).GetMomentum().Phi());
+            syncEvent.brawf_1 = bjets_pt.at(0)->rawf();
+            syncEvent.bmva_1 = bjets_pt.at(0)->mva();
+            syncEvent.bcsv_1 = bjets_pt.at(0)->csv();
+        } else {
+            syncEvent.bpt_1 = default_value;
+            syncEvent.beta_1 = default_value;
+            syncEvent.bphi_1 = default_value;
+            syncEvent.brawf_1 = default_value;
+            syncEvent.bmva_1 = default_value;
+            syncEvent.bcsv_1 = default_value;
+        }
+        if(bjets_pt.size() >= 2) {
+            syncEvent.bpt_2 = static_cast<float>(bjets_pt.at(1).GetMomentum().Pt());
+            syncEvent.beta_2 = static_cast<float>(bjets_pt.at(1).GetMomentum().Eta());
+            syncEvent.bphi_2 = static_cast<float>(bjets_pt.at(1).GetMomentum().Phi());
+            syncEvent.brawf_2 = bjets_pt.at(1)->rawf();
+            syncEvent.bmva_2 = bjets_pt.at(1)->mva();
+            syncEvent.bcsv_2 = bjets_pt.at(1)->csv();
+        } else {
+            syncEvent.bpt_2 = default_value;
+            syncEvent.beta_2 = default_value;
+            syncEvent.bphi_2 = default_value;
+            syncEvent.brawf_2 = default_value;
+            syncEvent.bmva_2 = default_value;
+            syncEvent.bcsv_2 = default_value;
+        }
+
+        syncEvent.dilepton_veto = tupleEvent.dilepton_veto();
+        syncEvent.extramuon_veto = tupleEvent.extramuon_veto();
+        syncEvent.extraelec_veto = tupleEvent.extraelec_veto();
+//            syncEvent.puweight = ;
+
+        if(syncMode == SyncMode::HH){
+
+            syncEvent.nbjets = static_cast<int>(bjets_csv.size());
+            if(bjets_csv.size() >= 1) {
+                syncEvent.bjet_pt_1 = static_cast<float>(bjets_csv.at(0).GetMomentum().Pt());
+                syncEvent.bjet_eta_1 = static_cast<float>(bjets_csv.at(0).GetMomentum().Eta());
+                syncEvent.bjet_phi_1 = static_cast<float>(bjets_csv.at(0).GetMomentum().Phi());
+                syncEvent.bjet_rawf_1 = bjets_csv.at(0)->rawf();
+                syncEvent.bjet_mva_1 = bjets_csv.at(0)->mva();
+                syncEvent.bjet_csv_1 = bjets_csv.at(0)->csv();
             } else {
-                sync().bpt_1 = default_value;
-                sync().beta_1 = default_value;
-                sync().bphi_1 = default_value;
-                sync().brawf_1 = default_value;
-                sync().bmva_1 = default_value;
-                sync().bcsv_1 = default_value;
+                syncEvent.bjet_pt_1 = default_value;
+                syncEvent.bjet_eta_1 = default_value;
+                syncEvent.bjet_phi_1 = default_value;
+                syncEvent.bjet_rawf_1 = default_value;
+                syncEvent.bjet_mva_1 = default_value;
+                syncEvent.bjet_csv_1 = default_value;
             }
-            if(bjets_pt.size() >= 2) {
-                sync().bpt_2 = static_cast<float>(bjets_pt.at(1).GetMomentum().Pt());
-                sync().beta_2 = static_cast<float>(bjets_pt.at(1).GetMomentum().Eta());
-                sync().bphi_2 = static_cast<float>(bjets_pt.at(1).GetMomentum().Phi());
-                sync().brawf_2 = bjets_pt.at(1)->rawf();
-                sync().bmva_2 = bjets_pt.at(1)->mva();
-                sync().bcsv_2 = bjets_pt.at(1)->csv();
+            if(bjets_csv.size() >= 2) {
+                syncEvent.bjet_pt_2 = static_cast<float>(bjets_csv.at(1).GetMomentum().Pt());
+                syncEvent.bjet_eta_2 = static_cast<float>(bjets_csv.at(1).GetMomentum().Eta());
+                syncEvent.bjet_phi_2 = static_cast<float>(bjets_csv.at(1).GetMomentum().Phi());
+                syncEvent.bjet_rawf_2 = bjets_csv.at(1)->rawf();
+                syncEvent.bjet_mva_2 = bjets_csv.at(1)->mva();
+                syncEvent.bjet_csv_2 = bjets_csv.at(1)->csv();
             } else {
-                sync().bpt_2 = default_value;
-                sync().beta_2 = default_value;
-                sync().bphi_2 = default_value;
-                sync().brawf_2 = default_value;
-                sync().bmva_2 = default_value;
-                sync().bcsv_2 = default_value;
+                syncEvent.bjet_pt_2 = default_value;
+                syncEvent.bjet_eta_2 = default_value;
+                syncEvent.bjet_phi_2 = default_value;
+                syncEvent.bjet_rawf_2 = default_value;
+                syncEvent.bjet_mva_2 = default_value;
+                syncEvent.bjet_csv_2 = default_value;
             }
 
-            sync().dilepton_veto = event->dilepton_veto;
-            sync().extramuon_veto = event->extramuon_veto;
-            sync().extraelec_veto = event->extraelec_veto;
-//            sync().puweight = ;
-
-            if(syncMode == SyncMode::HH){
-
-                sync().nbjets = static_cast<int>(bjets_csv.size());
-                if(bjets_csv.size() >= 1) {
-                    sync().bjet_pt_1 = static_cast<float>(bjets_csv.at(0).GetMomentum().Pt());
-                    sync().bjet_eta_1 = static_cast<float>(bjets_csv.at(0).GetMomentum().Eta());
-                    sync().bjet_phi_1 = static_cast<float>(bjets_csv.at(0).GetMomentum().Phi());
-                    sync().bjet_rawf_1 = bjets_csv.at(0)->rawf();
-                    sync().bjet_mva_1 = bjets_csv.at(0)->mva();
-                    sync().bjet_csv_1 = bjets_csv.at(0)->csv();
-                } else {
-                    sync().bjet_pt_1 = default_value;
-                    sync().bjet_eta_1 = default_value;
-                    sync().bjet_phi_1 = default_value;
-                    sync().bjet_rawf_1 = default_value;
-                    sync().bjet_mva_1 = default_value;
-                    sync().bjet_csv_1 = default_value;
-                }
-                if(bjets_csv.size() >= 2) {
-                    sync().bjet_pt_2 = static_cast<float>(bjets_csv.at(1).GetMomentum().Pt());
-                    sync().bjet_eta_2 = static_cast<float>(bjets_csv.at(1).GetMomentum().Eta());
-                    sync().bjet_phi_2 = static_cast<float>(bjets_csv.at(1).GetMomentum().Phi());
-                    sync().bjet_rawf_2 = bjets_csv.at(1)->rawf();
-                    sync().bjet_mva_2 = bjets_csv.at(1)->mva();
-                    sync().bjet_csv_2 = bjets_csv.at(1)->csv();
-                } else {
-                    sync().bjet_pt_2 = default_value;
-                    sync().bjet_eta_2 = default_value;
-                    sync().bjet_phi_2 = default_value;
-                    sync().bjet_rawf_2 = default_value;
-                    sync().bjet_mva_2 = default_value;
-                    sync().bjet_csv_2 = default_value;
-                }
 
+            if(tupleEvent.kinFit_convergence().size() > 0) {
+                if(bjets_csv.size() >= 2)
+                    syncEvent.kinfit_convergence = event.GetKinFitResults().convergence;
+                else
+                    syncEvent.kinfit_convergence = default_int_value;
 
-                if(event->kinFit_convergence.size() > 0) {
-                    if(bjets_csv.size() >= 2)
-                        sync().kinfit_convergence = event.GetKinFitResults().convergence;
-                    else
-                        sync().kinfit_convergence = default_int_value;
-
-                    if(bjets_csv.size() >= 2 && event.GetKinFitResults().HasValidMass())
-                        sync().m_kinfit = static_cast<float>(event.GetKinFitResults().mass);
-                    else
-                        sync().m_kinfit = default_value;
-                }
+                if(bjets_csv.size() >= 2 && event.GetKinFitResults().HasValidMass())
+                    syncEvent.m_kinfit = static_cast<float>(event.GetKinFitResults().mass);
+                else
+                    syncEvent.m_kinfit = default_value;
+            } else {
+                syncEvent.kinfit_convergence = default_int_value;
+                syncEvent.m_kinfit = default_value;
+            }
 
-                sync().deltaR_ll = ROOT::Math::VectorUtil::DeltaR(event->p4_1, event->p4_2);
-
-                sync().nFatJets = static_cast<unsigned>(event.GetFatJets().size());
-                const FatJetCandidate* fatJetPtr = event.SelectFatJet(30, 0.4);
-                sync().hasFatJet = bjets_csv.size() >= 2 ? fatJetPtr != nullptr : -1;
-                if(fatJetPtr) {
-                    const FatJetCandidate& fatJet = *fatJetPtr;
-                    sync().fatJet_pt = static_cast<float>(fatJet.GetMomentum().Pt());
-                    sync().fatJet_eta = static_cast<float>(fatJet.GetMomentum().Eta());
-                    sync().fatJet_phi = static_cast<float>(fatJet.GetMomentum().Phi());
-                    sync().fatJet_energy = static_cast<float>(fatJet.GetMomentum().E());
-                    sync().fatJet_m_pruned = fatJet->m(ntuple::TupleFatJet::MassType::Pruned);
-                    //                sync().fatJet_m_filtered = fatJet->m(ntuple::TupleFatJet::MassType::Filtered);
-                    //                sync().fatJet_m_trimmed = fatJet->m(ntuple::TupleFatJet::MassType::Trimmed);
-                    sync().fatJet_m_softDrop = fatJet->m(ntuple::TupleFatJet::MassType::SoftDrop);
-                    sync().fatJet_n_subjets = static_cast<int>(fatJet->subJets().size());
-                    sync().fatJet_n_subjettiness_tau1 = fatJet->n_subjettiness(1);
-                    sync().fatJet_n_subjettiness_tau2 = fatJet->n_subjettiness(2);
-                    sync().fatJet_n_subjettiness_tau3 = fatJet->n_subjettiness(3);
-                } else {
-                    sync().fatJet_pt = default_value;
-                    sync().fatJet_eta = default_value;
-                    sync().fatJet_phi = default_value;
-                    sync().fatJet_energy = default_value;
-                    sync().fatJet_m_pruned = default_value;
-                    sync().fatJet_m_filtered = default_value;
-                    sync().fatJet_m_trimmed = default_value;
-                    sync().fatJet_m_softDrop = default_value;
-                    sync().fatJet_n_subjets = default_int_value;
-                    sync().fatJet_n_subjettiness_tau1 = default_value;
-                    sync().fatJet_n_subjettiness_tau2 = default_value;
-                    sync().fatJet_n_subjettiness_tau3 = default_value;
-                }
+            syncEvent.deltaR_ll = ROOT::Math::VectorUtil::DeltaR(tupleEvent.p4_1(), tupleEvent.p4_2());
+
+            syncEvent.nFatJets = static_cast<unsigned>(event.GetFatJets().size());
+            const FatJetCandidate* fatJetPtr = event.SelectFatJet(30, 0.4);
+            syncEvent.hasFatJet = bjets_csv.size() >= 2 ? fatJetPtr != nullptr : -1;
+            if(fatJetPtr) {
+                const FatJetCandidate& fatJet = *fatJetPtr;
+                syncEvent.fatJet_pt = static_cast<float>(fatJet.GetMomentum().Pt());
+                syncEvent.fatJet_eta = static_cast<float>(fatJet.GetMomentum().Eta());
+                syncEvent.fatJet_phi = static_cast<float>(fatJet.GetMomentum().Phi());
+                syncEvent.fatJet_energy = static_cast<float>(fatJet.GetMomentum().E());
+                syncEvent.fatJet_m_pruned = fatJet->m(ntuple::TupleFatJet::MassType::Pruned);
+                syncEvent.fatJet_m_filtered = default_value;
+                syncEvent.fatJet_m_trimmed = default_value;
+                syncEvent.fatJet_m_softDrop = fatJet->m(ntuple::TupleFatJet::MassType::SoftDrop);
+                syncEvent.fatJet_n_subjets = static_cast<int>(fatJet->subJetCount());
+                syncEvent.fatJet_n_subjettiness_tau1 = fatJet->n_subjettiness(1);
+                syncEvent.fatJet_n_subjettiness_tau2 = fatJet->n_subjettiness(2);
+                syncEvent.fatJet_n_subjettiness_tau3 = fatJet->n_subjettiness(3);
+            } else {
+                syncEvent.fatJet_pt = default_value;
+                syncEvent.fatJet_eta = default_value;
+                syncEvent.fatJet_phi = default_value;
+                syncEvent.fatJet_energy = default_value;
+                syncEvent.fatJet_m_pruned = default_value;
+                syncEvent.fatJet_m_filtered = default_value;
+                syncEvent.fatJet_m_trimmed = default_value;
+                syncEvent.fatJet_m_softDrop = default_value;
+                syncEvent.fatJet_n_subjets = default_int_value;
+                syncEvent.fatJet_n_subjettiness_tau1 = default_value;
+                syncEvent.fatJet_n_subjettiness_tau2 = default_value;
+                syncEvent.fatJet_n_subjettiness_tau3 = default_value;
+            }
 
-                double topWeight = 1;
-                if(args.sample_type() == "ttbar") {
-                    for(size_t n = 0; n < event->genParticles_pdg.size(); ++n) {
-                        if(std::abs(event->genParticles_pdg.at(n)) != 6) continue;
-                        const double pt = event->genParticles_p4.at(n).pt();
-                        topWeight *= std::sqrt(std::exp(0.156 - 0.00137 * pt));
-                    }
+            double topWeight = 1;
+            if(args.sample_type() == "ttbar") {
+                for(size_t n = 0; n < tupleEvent.genParticles_pdg().size(); ++n) {
+                    if(std::abs(tupleEvent.genParticles_pdg().at(n)) != 6) continue;
+                    const double pt = tupleEvent.genParticles_p4().at(n).pt();
+                    topWeight *= std::sqrt(std::exp(0.156 - 0.00137 * pt));
                 }
-                sync().topWeight = static_cast<float>(topWeight);
-                sync().shapeWeight = static_cast<float>(
-                            eventWeights.GetWeight(*event, mc_corrections::WeightType::PileUp) * event->genEventWeight);
-                sync().btagWeight = static_cast<float>(
-                            eventWeights.GetWeight(*event, mc_corrections::WeightType::BTag));
-
-                sync().lhe_n_b_partons = static_cast<int>(event->lhe_n_b_partons);
-                sync().lhe_n_partons = static_cast<int>(event->lhe_n_partons);
-                sync().lhe_HT = event->lhe_HT;
-
-                sync().genJets_nTotal = event->genJets_nTotal;
-                sync().genJets_nStored = static_cast<unsigned>(event->genJets_p4.size());
-                sync().genJets_nStored_hadronFlavour_b = std::min<unsigned>(2, static_cast<unsigned>(
-                            std::count(event->genJets_hadronFlavour.begin(), event->genJets_hadronFlavour.end(), 5)));
-                sync().genJets_nStored_hadronFlavour_c = static_cast<unsigned>(
-                            std::count(event->genJets_hadronFlavour.begin(), event->genJets_hadronFlavour.end(), 4));
-                sync().jets_nTotal_hadronFlavour_b = event->jets_nTotal_hadronFlavour_b;
-                sync().jets_nTotal_hadronFlavour_c = event->jets_nTotal_hadronFlavour_c;
-                sync().jets_nSelected_hadronFlavour_b = static_cast<unsigned>(
-                            std::count(event->jets_hadronFlavour.begin(), event->jets_hadronFlavour.end(), 5));
-                sync().jets_nSelected_hadronFlavour_c = static_cast<unsigned>(
-                            std::count(event->jets_hadronFlavour.begin(), event->jets_hadronFlavour.end(), 4));
             }
-
-            sync.Fill();
+            syncEvent.topWeight = static_cast<float>(topWeight);
+            syncEvent.shapeWeight = static_cast<float>(
+                        weights.GetWeight(*event, mc_corrections::WeightType::PileUp) * tupleEvent.genEventWeight());
+            syncEvent.btagWeight = static_cast<float>(
+                        weights.GetWeight(*event, mc_corrections::WeightType::BTag));
+
+            syncEvent.lhe_n_b_partons = static_cast<int>(tupleEvent.lhe_n_b_partons());
+            syncEvent.lhe_n_partons = static_cast<int>(tupleEvent.lhe_n_partons());
+            syncEvent.lhe_HT = tupleEvent.lhe_HT();
+
+            syncEvent.genJets_nTotal = tupleEvent.genJets_nTotal();
+            syncEvent.genJets_nStored = static_cast<unsigned>(tupleEvent.genJets_p4().size());
+            const auto& genJets_hadronFlavour = tupleEvent.genJets_hadronFlavour();
+            syncEvent.genJets_nStored_hadronFlavour_b = std::min<unsigned>(2, static_cast<unsigned>(
+                        std::count(genJets_hadronFlavour.begin(), genJets_hadronFlavour.end(), 5)));
+            syncEvent.genJets_nStored_hadronFlavour_c = static_cast<unsigned>(
+                        std::count(genJets_hadronFlavour.begin(), genJets_hadronFlavour.end(), 4));
+            syncEvent.jets_nTotal_hadronFlavour_b = tupleEvent.jets_nTotal_hadronFlavour_b();
+            syncEvent.jets_nTotal_hadronFlavour_c = tupleEvent.jets_nTotal_hadronFlavour_c();
+            const auto& jets_hadronFlavour = tupleEvent.jets_hadronFlavour();
+            syncEvent.jets_nSelected_hadronFlavour_b = static_cast<unsigned>(
+                        std::count(jets_hadronFlavour.begin(), jets_hadronFlavour.end(), 5));
+            syncEvent.jets_nSelected_hadronFlavour_c = static_cast<unsigned>(
+                        std::count(jets_hadronFlavour.begin(), jets_hadronFlavour.end(), 4));
         }
-
-        sync.Write();
     }
 
-private:
     Arguments args;
     SyncMode syncMode;
-    mc_corrections::EventWeights eventWeights;
+    EventWeights eventWeights;
+    std::set<std::string> enabledBranches;
 };
 
 } // namespace analysis
@@ -0,0 +1,166 @@
+/*! Benchmark of the jet selection based on the columnar jet view against a copy of the jet selection that was used
+before its introduction. Both selections use the same EventInfoBase instance, which is reset for each event, so that
+only the jet selection itself is compared.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "h-tautau/Analysis/include/EventInfo.h"
+#include "h-tautau/Cuts/include/Btag_2016.h"
+
+struct Arguments {
+    run::Argument<std::string> input_file{"input_file", "input file"};
+    run::Argument<std::string> tree_name{"tree_name", "tree name"};
+    run::Argument<unsigned> n_iterations{"n_iterations", "number of passes over the input events", 10};
+};
+
+namespace analysis {
+
+class JetSelection_t {
+public:
+    using Event = ntuple::Event;
+    using JetCollection = EventInfoBase::JetCollection;
+    using Clock = std::chrono::high_resolution_clock;
+
+    JetSelection_t(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        auto inputFile = root_ext::OpenRootFile(args.input_file());
+        auto eventTuple = ntuple::CreateEventTuple(args.tree_name(), inputFile.get(), true, ntuple::TreeState::Full);
+        std::vector<Event> events;
+        for(const Event& event : *eventTuple) {
+            if(ntuple::EventLoader::IsFullyStored(event))
+                events.push_back(event);
+        }
+        std::cout << "Number of loaded fully stored events: " << events.size() << std::endl;
+
+        size_t legacy_checksum = 0, view_checksum = 0;
+        const double legacy_rate = Measure(events, [&](const Event& event) {
+            legacy_checksum += ProcessLegacy(event);
+        });
+        const double view_rate = Measure(events, [&](const Event& event) {
+            view_checksum += ProcessView(event);
+        });
+
+        if(legacy_checksum != view_checksum)
+            throw exception("Jet selection results differ: legacy checksum = %1%, view checksum = %2%.")
+                % legacy_checksum % view_checksum;
+
+        std::cout << boost::format("Legacy selection: %1% events/s.\nColumnar view selection: %2% events/s.\n"
+                                   "Speed-up: %3%.\n") % legacy_rate % view_rate % (view_rate / legacy_rate);
+    }
+
+private:
+    template<typename Function>
+    double Measure(const std::vector<Event>& events, Function&& process) const
+    {
+        const auto start = Clock::now();
+        for(unsigned n = 0; n < args.n_iterations(); ++n) {
+            for(const Event& event : events)
+                process(event);
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        return events.size() * args.n_iterations() / elapsed.count();
+    }
+
+    // Copy of the jet selection of EventInfoBase as it was before the introduction of ntuple::TupleJetView: all jets
+    // are stored into a list of tuple jets and a shared collection of candidates, which are created for each event,
+    // and each selection returns a new collection.
+    class LegacyJetSelection {
+    public:
+        explicit LegacyJetSelection(const ntuple::EventAccessor& _event) : event(_event) {}
+
+        const JetCollection& GetJets()
+        {
+            if(!jets) {
+                jets = std::shared_ptr<JetCollection>(new JetCollection());
+                for(size_t n = 0; n < event.jets_p4().size(); ++n) {
+                    tuple_jets.push_back(ntuple::TupleJet(event, n));
+                    jets->push_back(JetCandidate(tuple_jets.back()));
+                }
+            }
+            return *jets;
+        }
+
+        JetCollection SelectJets(double pt_cut, double eta_cut, double csv_cut, JetOrdering jet_ordering)
+        {
+            const auto orderer = [&](const JetCandidate& j1, const JetCandidate& j2) -> bool {
+                if(jet_ordering == JetOrdering::Pt)
+                    return j1.GetMomentum().Pt() > j2.GetMomentum().Pt();
+                return j1->csv() > j2->csv();
+            };
+
+            const JetCollection& all_jets = GetJets();
+            JetCollection selected_jets;
+            for(const JetCandidate& jet : all_jets) {
+                if(jet.GetMomentum().Pt() > pt_cut && std::abs(jet.GetMomentum().eta()) < eta_cut
+                        && jet->csv() > csv_cut)
+                    selected_jets.push_back(jet);
+            }
+
+            if(jet_ordering != JetOrdering::NoOrdering)
+                std::sort(selected_jets.begin(), selected_jets.end(), orderer);
+            return selected_jets;
+        }
+
+    private:
+        ntuple::EventAccessor event;
+        std::list<ntuple::TupleJet> tuple_jets;
+        std::shared_ptr<JetCollection> jets;
+    };
+
+    EventInfoBase& ResetEventInfo(const Event& event)
+    {
+        const ntuple::EventAccessor accessor(event);
+        if(!eventInfo)
+            eventInfo = std::make_shared<EventInfoBase>(accessor);
+        else
+            eventInfo->Reset(accessor);
+        return *eventInfo;
+    }
+
+    static size_t GetChecksum(const JetCollection& jets_pt20, const JetCollection& jets_pt30,
+                              const JetCollection& bjets_pt, const JetCollection& bjets_csv)
+    {
+        size_t checksum = jets_pt20.size() + jets_pt30.size() + bjets_pt.size();
+        if(bjets_csv.size() >= 2)
+            checksum += static_cast<size_t>(bjets_csv.at(0).GetMomentum().Pt());
+        return checksum;
+    }
+
+    size_t ProcessLegacy(const Event& event)
+    {
+        using namespace cuts::btag_2016;
+        EventInfoBase& eventInfo = ResetEventInfo(event);
+        LegacyJetSelection legacy(eventInfo.GetEventAccessor());
+        const auto jets_pt20 = legacy.SelectJets(20, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
+        const auto jets_pt30 = legacy.SelectJets(30, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
+        const auto bjets_pt = legacy.SelectJets(pt, eta, CSVv2M, JetOrdering::Pt);
+        const auto bjets_csv = legacy.SelectJets(pt, eta, std::numeric_limits<double>::lowest(), JetOrdering::CSV);
+        return GetChecksum(jets_pt20, jets_pt30, bjets_pt, bjets_csv);
+    }
+
+    size_t ProcessView(const Event& event)
+    {
+        using namespace cuts::btag_2016;
+        EventInfoBase& eventInfo = ResetEventInfo(event);
+        eventInfo.SelectJets(jets_pt20, 20, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
+        eventInfo.SelectJets(jets_pt30, 30, 4.7, std::numeric_limits<double>::lowest(), JetOrdering::Pt);
+        eventInfo.SelectJets(bjets_pt, pt, eta, CSVv2M, JetOrdering::Pt);
+        eventInfo.SelectJets(bjets_csv, pt, eta, std::numeric_limits<double>::lowest(), JetOrdering::CSV);
+        return GetChecksum(jets_pt20, jets_pt30, bjets_pt, bjets_csv);
+    }
+
+private:
+    Arguments args;
+    std::shared_ptr<EventInfoBase> eventInfo;
+    JetCollection jets_pt20, jets_pt30, bjets_pt, bjets_csv;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::JetSelection_t, Arguments)
@@ -0,0 +1,84 @@
+/*! Test of the loading of partially stored events in random order using the reference event resolver.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <algorithm>
+#include <random>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "h-tautau/Analysis/include/ReferenceEventResolver.h"
+
+struct Arguments {
+    run::Argument<std::string> input_file{"input_file", "input file"};
+    run::Argument<std::string> tree_name{"tree_name", "tree name"};
+    run::Argument<unsigned> max_entries{"max_entries", "maximal number of entries to check", 100000};
+};
+
+namespace analysis {
+
+class ReferenceEventResolver_t {
+public:
+    using Event = ntuple::Event;
+
+    ReferenceEventResolver_t(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        auto inputFile = root_ext::OpenRootFile(args.input_file());
+        auto eventTuple = ntuple::CreateEventTuple(args.tree_name(), inputFile.get(), true, ntuple::TreeState::Full);
+        const Long64_t n_entries = std::min<Long64_t>(eventTuple->GetEntries(), args.max_entries());
+
+        // Sequential loading with the last fully stored entry as the reference.
+        std::vector<Event> expected;
+        Event ref;
+        size_t n_partial = 0;
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            eventTuple->GetEntry(entry);
+            Event event = eventTuple->data();
+            if(ntuple::EventLoader::IsFullyStored(event)) {
+                ref = event;
+            } else {
+                ntuple::EventLoader::Load(event, &ref);
+                ++n_partial;
+            }
+            expected.push_back(event);
+        }
+
+        std::vector<Long64_t> entries(static_cast<size_t>(n_entries));
+        for(Long64_t entry = 0; entry < n_entries; ++entry)
+            entries[static_cast<size_t>(entry)] = entry;
+        std::shuffle(entries.begin(), entries.end(), std::mt19937());
+
+        ntuple::ReferenceEventResolver resolver(args.input_file(), args.tree_name(), ntuple::TreeState::Full);
+        for(Long64_t entry : entries) {
+            eventTuple->GetEntry(entry);
+            Event event = eventTuple->data();
+            resolver.Load(event, entry);
+            if(!IsSameEvent(event, expected.at(static_cast<size_t>(entry))))
+                throw exception("Event loaded in random order differs from the sequentially loaded event in entry %1%.")
+                    % entry;
+        }
+
+        std::cout << boost::format("%1% entries checked: %2% partially stored, %3% references.\n")
+                     % n_entries % n_partial % resolver.GetNumberOfReferences();
+    }
+
+private:
+    static bool IsSameEvent(const Event& event, const Event& other)
+    {
+        Event copy(event);
+        const ntuple::EventBranchMask same = ntuple::ClearBranchesSameAsReference(copy, other);
+        for(size_t n = 0; n < ntuple::NumberOfEventBranches; ++n) {
+            if(ntuple::IsReferenceCompatibleBranch(static_cast<ntuple::EventBranch>(n)) && !same[n])
+                return false;
+        }
+        return event.run == other.run && event.lumi == other.lumi && event.evt == other.evt
+            && event.eventEnergyScale == other.eventEnergyScale;
+    }
+
+private:
+    Arguments args;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::ReferenceEventResolver_t, Arguments)
@@ -0,0 +1,63 @@
+/*! Entry by entry comparison of two synchronization tuples, e.g. produced by SyncTreeProducer with n_threads = 1
+and n_threads > 1.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include "AnalysisTools/Run/include/program_main.h"
+#include "AnalysisTools/Core/include/RootExt.h"
+#include "h-tautau/Analysis/include/SyncTupleHTT.h"
+
+struct Arguments {
+    run::Argument<std::string> reference_file{"reference_file", "sync tuple produced by the serial loop"};
+    run::Argument<std::string> test_file{"test_file", "sync tuple to compare with the reference"};
+    run::Argument<std::string> tree_name{"tree_name", "tree name"};
+    run::Argument<unsigned> max_reported{"max_reported", "maximal number of reported differences", 10};
+};
+
+namespace analysis {
+
+class SyncTupleComparison_t {
+public:
+    using SyncTuple = htt_sync::SyncTuple;
+
+    SyncTupleComparison_t(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        auto referenceFile = root_ext::OpenRootFile(args.reference_file());
+        auto testFile = root_ext::OpenRootFile(args.test_file());
+        SyncTuple referenceTuple(args.tree_name(), referenceFile.get(), true);
+        SyncTuple testTuple(args.tree_name(), testFile.get(), true);
+
+        const Long64_t n_entries = referenceTuple.GetEntries();
+        if(testTuple.GetEntries() != n_entries)
+            throw exception("Number of entries is different: %1% in the reference, %2% in the test tuple.")
+                % n_entries % testTuple.GetEntries();
+
+        size_t n_different = 0;
+        for(Long64_t entry = 0; entry < n_entries; ++entry) {
+            referenceTuple.GetEntry(entry);
+            testTuple.GetEntry(entry);
+            const auto branches = htt_sync::FindDifferentBranches(referenceTuple.data(), testTuple.data());
+            if(branches.empty()) continue;
+            if(n_different < args.max_reported()) {
+                std::cout << boost::format("Entry %1% (%2%:%3%:%4%) differs in:") % entry
+                             % referenceTuple.data().run % referenceTuple.data().lumi % referenceTuple.data().evt;
+                for(const auto& branch : branches)
+                    std::cout << " " << branch;
+                std::cout << std::endl;
+            }
+            ++n_different;
+        }
+
+        if(n_different)
+            throw exception("%1% out of %2% entries are different.") % n_different % n_entries;
+        std::cout << boost::format("All %1% entries are identical.\n") % n_entries;
+    }
+
+private:
+    Arguments args;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::SyncTupleComparison_t, Arguments)
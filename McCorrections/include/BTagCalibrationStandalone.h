@@ -11,6 +11,7 @@ and https://github.com/cms-sw/cmssw/blob/CMSSW_7_4_X/RecoBTag/PerformanceDB/test
 #include <vector>
 #include <exception>
 #include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <fstream>
 #include <iostream>
@@ -555,6 +556,27 @@ public:
     float discrMin;
     float discrMax;
     TF1 func;
+    std::vector<double> table;  // values of func at equidistant nodes; empty if func is evaluated directly
+    double tableMin;
+    double tableStep;
+
+    void tabulate(double xMin, double xMax);
+    double evalFunc(double x) const;
+  };
+
+  // Entries to evaluate for all combinations of the eta, pt and discr bins, where the bin edges are the union of the
+  // boundaries of all entries. The first and the last bin of each axis are under- and overflow bins.
+  struct BinnedLookup {
+    std::vector<float> etaEdges;
+    std::vector<float> ptEdges;
+    std::vector<float> discrEdges;
+    size_t nEta;
+    size_t nPt;
+    size_t nDiscr;
+    std::vector<int> entryIndices;                    // by (eta, pt, discr) bin; -1 if no entry is found
+    std::vector<std::pair<float, float> > ptBounds;   // min_max_pt results by (eta, discr) bin
+
+    BinnedLookup() : nEta(1), nPt(1), nDiscr(1), entryIndices(1, -1), ptBounds(1, std::make_pair(-1.f, -1.f)) {}
   };
 
 private:
@@ -581,10 +603,15 @@ private:
                                      float eta,
                                      float discr) const;
 
+  void buildLookup(BTagEntry::JetFlavor jf);
+  size_t findEtaBin(BTagEntry::JetFlavor jf, float eta) const;
+  size_t findDiscrBin(BTagEntry::JetFlavor jf, float discr) const;
+
   BTagEntry::OperatingPoint op_;
   std::string sysType_;
   std::vector<std::vector<TmpEntry> > tmpData_;  // first index: jetFlavor
   std::vector<bool> useAbsEta_;                  // first index: jetFlavor
+  std::vector<BinnedLookup> lookups_;            // first index: jetFlavor
   std::map<std::string, std::shared_ptr<BTagCalibrationReaderImpl>> otherSysTypeReaders_;
 };
 
@@ -596,7 +623,8 @@ BTagCalibrationReader::BTagCalibrationReaderImpl::BTagCalibrationReaderImpl(
   op_(op),
   sysType_(sysType),
   tmpData_(3),
-  useAbsEta_(3, true)
+  useAbsEta_(3, true),
+  lookups_(3)
 {
   for (const std::string & ost : otherSysTypes) {
     if (otherSysTypeReaders_.count(ost)) {
@@ -642,9 +670,11 @@ throw std::exception();
     if (op_ == BTagEntry::OP_RESHAPING) {
       te.func = TF1("", be.formula.c_str(),
                     be.params.discrMin, be.params.discrMax);
+      te.tabulate(be.params.discrMin, be.params.discrMax);
     } else {
       te.func = TF1("", be.formula.c_str(),
                     be.params.ptMin, be.params.ptMax);
+      te.tabulate(be.params.ptMin, be.params.ptMax);
     }
 
     tmpData_[be.params.jetFlavor].push_back(te);
@@ -652,6 +682,7 @@ throw std::exception();
       useAbsEta_[be.params.jetFlavor] = false;
     }
   }
+  buildLookup(jf);
 
   for (auto & p : otherSysTypeReaders_) {
     p.second->load(c, jf, measurementType);
@@ -669,26 +700,18 @@ double BTagCalibrationReader::BTagCalibrationReaderImpl::eval(
     eta = -eta;
   }
 
-  // search linearly through eta, pt and discr ranges and eval
-  // future: find some clever data structure based on intervals
-  const auto &entries = tmpData_.at(jf);
-  for (unsigned i=0; i<entries.size(); ++i) {
-    const auto &e = entries.at(i);
-    if (
-      e.etaMin <= eta && eta < e.etaMax                   // find eta
-      && e.ptMin < pt && pt <= e.ptMax                    // check pt
-    ){
-      if (use_discr) {                                    // discr. reshaping?
-        if (e.discrMin <= discr && discr < e.discrMax) {  // check discr
-          return e.func.Eval(discr);
-        }
-      } else {
-        return e.func.Eval(pt);
-      }
-    }
+  // same result as the linear search through eta, pt and discr ranges, using the pre-computed bins
+  // pt ranges are open on the left side, so the pt bin is found by lower_bound
+  const BinnedLookup &lookup = lookups_.at(jf);
+  const size_t eta_bin = findEtaBin(jf, eta);
+  const size_t pt_bin = std::lower_bound(lookup.ptEdges.begin(), lookup.ptEdges.end(), pt)
+                        - lookup.ptEdges.begin();
+  const size_t discr_bin = findDiscrBin(jf, discr);
+  const int index = lookup.entryIndices[(eta_bin * lookup.nPt + pt_bin) * lookup.nDiscr + discr_bin];
+  if (index < 0) {
+    return 0.;  // default value
   }
-
-  return 0.;  // default value
+  return tmpData_[jf][index].evalFunc(use_discr ? discr : pt);
 }
 
 double BTagCalibrationReader::BTagCalibrationReaderImpl::eval_auto_bounds(
@@ -738,36 +761,159 @@ std::pair<float, float> BTagCalibrationReader::BTagCalibrationReaderImpl::min_ma
                                                float eta,
                                                float discr) const
 {
-  bool use_discr = (op_ == BTagEntry::OP_RESHAPING);
   if (useAbsEta_[jf] && eta < 0) {
     eta = -eta;
   }
 
+  const BinnedLookup &lookup = lookups_.at(jf);
+  return lookup.ptBounds[findEtaBin(jf, eta) * lookup.nDiscr + findDiscrBin(jf, discr)];
+}
+
+size_t BTagCalibrationReader::BTagCalibrationReaderImpl::findEtaBin(
+                                               BTagEntry::JetFlavor jf,
+                                               float eta) const
+{
+  const auto &edges = lookups_.at(jf).etaEdges;
+  return std::upper_bound(edges.begin(), edges.end(), eta) - edges.begin();
+}
+
+size_t BTagCalibrationReader::BTagCalibrationReaderImpl::findDiscrBin(
+                                               BTagEntry::JetFlavor jf,
+                                               float discr) const
+{
+  if (op_ != BTagEntry::OP_RESHAPING) {
+    return 0;
+  }
+  const auto &edges = lookups_.at(jf).discrEdges;
+  return std::upper_bound(edges.begin(), edges.end(), discr) - edges.begin();
+}
+
+// Since the bin edges include the boundaries of all entries, each bin is either fully inside or fully outside of
+// the range of each entry. The results for a bin are found by the same linear search as was used for each call
+// of eval and min_max_pt before, with the range checks replaced by the bin containment checks.
+void BTagCalibrationReader::BTagCalibrationReaderImpl::buildLookup(
+                                               BTagEntry::JetFlavor jf)
+{
+  bool use_discr = (op_ == BTagEntry::OP_RESHAPING);
   const auto &entries = tmpData_.at(jf);
-  float min_pt = -1., max_pt = -1.;
-  for (const auto & e: entries) {
-    if (
-      e.etaMin <= eta && eta < e.etaMax                   // find eta
-    ){
-      if (min_pt < 0.) {                                  // init
-        min_pt = e.ptMin;
-        max_pt = e.ptMax;
-        continue;
+  BinnedLookup &lookup = lookups_.at(jf);
+
+  const auto makeEdges = [&](float TmpEntry::*min_value, float TmpEntry::*max_value) {
+    std::vector<float> edges;
+    for (const auto &e : entries) {
+      edges.push_back(e.*min_value);
+      edges.push_back(e.*max_value);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    return edges;
+  };
+  const auto contains = [](const std::vector<float> &edges, size_t bin, float min_value, float max_value) {
+    return bin > 0 && bin < edges.size() && min_value <= edges[bin - 1] && edges[bin] <= max_value;
+  };
+
+  lookup.etaEdges = makeEdges(&TmpEntry::etaMin, &TmpEntry::etaMax);
+  lookup.ptEdges = makeEdges(&TmpEntry::ptMin, &TmpEntry::ptMax);
+  lookup.discrEdges = use_discr ? makeEdges(&TmpEntry::discrMin, &TmpEntry::discrMax) : std::vector<float>();
+  lookup.nEta = lookup.etaEdges.size() + 1;
+  lookup.nPt = lookup.ptEdges.size() + 1;
+  lookup.nDiscr = use_discr ? lookup.discrEdges.size() + 1 : 1;
+  lookup.entryIndices.assign(lookup.nEta * lookup.nPt * lookup.nDiscr, -1);
+  lookup.ptBounds.assign(lookup.nEta * lookup.nDiscr, std::make_pair(-1.f, -1.f));
+
+  for (size_t eta_bin = 0; eta_bin < lookup.nEta; ++eta_bin) {
+    for (size_t discr_bin = 0; discr_bin < lookup.nDiscr; ++discr_bin) {
+      auto &bounds = lookup.ptBounds[eta_bin * lookup.nDiscr + discr_bin];
+      for (const auto &e : entries) {
+        if (!contains(lookup.etaEdges, eta_bin, e.etaMin, e.etaMax)) {
+          continue;
+        }
+        if (bounds.first < 0.) {
+          bounds = std::make_pair(e.ptMin, e.ptMax);
+          continue;
+        }
+        if (use_discr && !contains(lookup.discrEdges, discr_bin, e.discrMin, e.discrMax)) {
+          continue;
+        }
+        bounds.first = bounds.first < e.ptMin ? bounds.first : e.ptMin;
+        bounds.second = bounds.second > e.ptMax ? bounds.second : e.ptMax;
+      }
+
+      for (size_t pt_bin = 0; pt_bin < lookup.nPt; ++pt_bin) {
+        int &index = lookup.entryIndices[(eta_bin * lookup.nPt + pt_bin) * lookup.nDiscr + discr_bin];
+        for (size_t i = 0; i < entries.size(); ++i) {
+          const auto &e = entries[i];
+          if (contains(lookup.etaEdges, eta_bin, e.etaMin, e.etaMax)
+              && contains(lookup.ptEdges, pt_bin, e.ptMin, e.ptMax)
+              && (!use_discr || contains(lookup.discrEdges, discr_bin, e.discrMin, e.discrMax))) {
+            index = static_cast<int>(i);
+            break;
+          }
+        }
       }
+    }
+  }
+}
 
-      if (use_discr) {                                    // discr. reshaping?
-        if (e.discrMin <= discr && discr < e.discrMax) {  // check discr
-          min_pt = min_pt < e.ptMin ? min_pt : e.ptMin;
-          max_pt = max_pt > e.ptMax ? max_pt : e.ptMax;
+// The function is replaced by a cubic interpolation between equidistant nodes if, for some number of nodes,
+// the interpolation agrees with the function within the tolerance at the control points inside each interval.
+// Otherwise the function is evaluated directly.
+void BTagCalibrationReader::BTagCalibrationReaderImpl::TmpEntry::tabulate(
+                                               double xMin,
+                                               double xMax)
+{
+  static constexpr size_t minNodes = 256, maxNodes = 16384;
+  static constexpr double tolerance = 1e-7;
+
+  table.clear();
+  tableMin = xMin;
+  tableStep = 0.;
+  if (!(xMin < xMax) || !std::isfinite(xMax - xMin)) {
+    return;
+  }
+
+  for (size_t n_nodes = minNodes; n_nodes <= maxNodes; n_nodes *= 2) {
+    tableMin = xMin;
+    tableStep = (xMax - xMin) / (n_nodes - 1);
+    table.resize(n_nodes);
+    for (size_t n = 0; n < n_nodes; ++n) {
+      table[n] = func.Eval(xMin + n * tableStep);
+    }
+
+    bool is_accurate = true;
+    for (size_t n = 0; n < n_nodes - 1 && is_accurate; ++n) {
+      for (double t : { 0.25, 0.5, 0.75 }) {
+        const double x = xMin + (n + t) * tableStep;
+        const double ref = func.Eval(x);
+        if (!(std::abs(evalFunc(x) - ref) <= tolerance * std::max(1., std::abs(ref)))) {
+          is_accurate = false;
+          break;
         }
-      } else {
-        min_pt = min_pt < e.ptMin ? min_pt : e.ptMin;
-        max_pt = max_pt > e.ptMax ? max_pt : e.ptMax;
       }
     }
+    if (is_accurate) {
+      return;
+    }
   }
+  table.clear();
+}
 
-  return std::make_pair(min_pt, max_pt);
+double BTagCalibrationReader::BTagCalibrationReaderImpl::TmpEntry::evalFunc(double x) const
+{
+  if (table.empty()) {
+    return func.Eval(x);
+  }
+
+  // cubic Hermite interpolation with the Catmull-Rom tangents
+  const size_t n_nodes = table.size();
+  const double u = (x - tableMin) / tableStep;
+  const size_t i = u <= 0 ? 0 : std::min(static_cast<size_t>(u), n_nodes - 2);
+  const double t = u - i;
+  const double p0 = table[i], p1 = table[i + 1];
+  const double m0 = i > 0 ? (p1 - table[i - 1]) / 2 : p1 - p0;
+  const double m1 = i + 2 < n_nodes ? (table[i + 2] - p0) / 2 : p1 - p0;
+  const double t2 = t * t, t3 = t2 * t;
+  return (2 * t3 - 3 * t2 + 1) * p0 + (t3 - 2 * t2 + t) * m0 + (-2 * t3 + 3 * t2) * p1 + (t3 - t2) * m1;
 }
 
 
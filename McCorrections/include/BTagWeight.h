@@ -2,11 +2,14 @@
 Original code: https://github.com/ajgilbert/ICHiggsTauTau/blob/master/Analysis/Utilities/src/BTagWeight.cc
 This file is part of https://github.com/hh-italian-group/hh-bbtautau. */
 
+#include <array>
 #include <TH2.h>
 
 #include "AnalysisTools/Core/include/RootExt.h"
 #include "h-tautau/Analysis/include/AnalysisTypes.h"
+#include "h-tautau/Analysis/include/TupleObjects.h"
 #include "BTagCalibrationStandalone.h"
+#include "FlatHistLookup.h"
 #include "h-tautau/Cuts/include/Btag_2016.h"
 #include "WeightProvider.h"
 #include "TextIO.h"
@@ -34,13 +37,13 @@ struct JetInfo {
 
 struct BTagReaderInfo {
     using ReaderPtr = std::shared_ptr<btag_calibration::BTagCalibrationReader>;
-    using HistPtr = std::shared_ptr<TH2D>;
     using JetFlavor = btag_calibration::BTagEntry::JetFlavor;
     using FilePtr = std::shared_ptr<TFile>;
+    static constexpr size_t NumberOfScales = 3;
 
     ReaderPtr reader;
     JetFlavor flavor;
-    HistPtr eff_hist;
+    FlatHistLookup2D eff_table;
 
     BTagReaderInfo(ReaderPtr _reader, JetFlavor _flavor, FilePtr file, DiscriminatorWP wp) :
         reader(_reader), flavor(_flavor)
@@ -63,24 +66,30 @@ struct BTagReaderInfo {
 
         const std::string name = boost::str(boost::format("All/Efficiency/%1%_%2%_all")
                                             % flavor_prefixes.at(flavor) % wp_prefixes.at(wp));
-        eff_hist = HistPtr(root_ext::ReadCloneObject<TH2D>(*file, name, "", true));
+        std::unique_ptr<TH2D> eff_hist(root_ext::ReadCloneObject<TH2D>(*file, name, "", true));
+        eff_table = FlatHistLookup2D(*eff_hist);
     }
 
-    void Eval(JetInfo& jetInfo, const std::string& unc_name)
+    void Eval(JetInfo& jetInfo, const std::string& unc_name) const
     {
         jetInfo.SF  = reader->eval_auto_bounds(unc_name, flavor, static_cast<float>(jetInfo.eta),
                                                static_cast<float>(jetInfo.pt));
-        jetInfo.eff = GetEfficiency(jetInfo.pt, std::abs(jetInfo.eta));
+        jetInfo.eff = eff_table.GetClamped(jetInfo.pt, std::abs(jetInfo.eta));
     }
 
-private:
-    double GetEfficiency(double pt, double eta) const
+    // Evaluates SFs for all uncertainty scales, indexed by UncertaintyScale, and returns the efficiency.
+    double EvalAllScales(double pt, double eta, double* SF) const
+    {
+        for(size_t scale = 0; scale < NumberOfScales; ++scale)
+            SF[scale] = reader->eval_auto_bounds(GetUncertaintyName(static_cast<UncertaintyScale>(scale)), flavor,
+                                                 static_cast<float>(eta), static_cast<float>(pt));
+        return eff_table.GetClamped(pt, std::abs(eta));
+    }
+
+    static const std::string& GetUncertaintyName(UncertaintyScale unc)
     {
-        int xBin = eff_hist->GetXaxis()->FindFixBin(pt);
-        xBin = std::min(eff_hist->GetXaxis()->GetNbins(), std::max(1, xBin));
-        int yBin = eff_hist->GetYaxis()->FindFixBin(eta);
-        yBin = std::min(eff_hist->GetYaxis()->GetNbins(), std::max(1, yBin));
-        return eff_hist->GetBinContent(xBin, yBin);
+        static const std::array<std::string, NumberOfScales> names = {{ "central", "up", "down" }};
+        return names.at(static_cast<size_t>(unc));
     }
 };
 
@@ -99,6 +108,8 @@ public:
     using ReaderInfoPtr = std::shared_ptr<detail::BTagReaderInfo>;
     using ReaderInfoMap = std::map<int, ReaderInfoPtr>;
     using ReaderPtr = std::shared_ptr<btag_calibration::BTagCalibrationReader>;
+    static constexpr size_t NumberOfScales = ReaderInfo::NumberOfScales;
+    using ScaleWeights = std::array<double, NumberOfScales>; // indexed by UncertaintyScale
 
     BTagWeight(const std::string& bTagEffFileName, const std::string& bjetSFFileName, DiscriminatorWP wp) :
         calib("CSVv2", bjetSFFileName)
@@ -143,9 +154,14 @@ public:
         throw exception("ExpressEvent is not supported in BTagWeight::Get.");
     }
 
+    virtual std::set<std::string> GetRequiredBranches() const override
+    {
+        return { "jets_p4", "jets_csv", "jets_hadronFlavour" };
+    }
+
     double GetEx(const ntuple::Event& event, UncertaintyScale unc) const
     {
-        const std::string unc_name = GetUncertantyName(unc);
+        const std::string& unc_name = ReaderInfo::GetUncertaintyName(unc);
 
         JetInfoVector jetInfos;
         for (size_t jetIndex = 0; jetIndex < event.jets_p4.size(); ++jetIndex) {
@@ -159,13 +175,66 @@ public:
         return GetBtagWeight(jetInfos);
     }
 
+    ScaleWeights GetAllScales(const ntuple::Event& event) const
+    {
+        const auto& p4 = event.jets_p4;
+        CheckJetColumns(p4.size(), p4.size(), event.jets_csv.size(), event.jets_hadronFlavour.size());
+        double MC = 1;
+        ScaleWeights Data;
+        Data.fill(1.);
+        for(size_t n = 0; n < p4.size(); ++n)
+            AddJet(p4[n].pt(), p4[n].eta(), event.jets_csv[n], event.jets_hadronFlavour[n], MC, Data);
+        return GetScaleWeights(MC, Data);
+    }
+
+    ScaleWeights GetAllScales(const ntuple::TupleJetView& jets) const
+    {
+        return GetAllScales(jets.pt(), jets.eta(), jets.csv(), jets.hadronFlavour());
+    }
+
+    // Central, up and down weights computed in one pass over the jets. SFs for all scales are looked up together and
+    // the products are accumulated on the fly, so no memory is allocated per call.
+    template<typename PtColumn, typename EtaColumn, typename CsvColumn, typename FlavourColumn>
+    ScaleWeights GetAllScales(const PtColumn& pt, const EtaColumn& eta, const CsvColumn& csv,
+                              const FlavourColumn& hadronFlavour) const
+    {
+        CheckJetColumns(pt.size(), eta.size(), csv.size(), hadronFlavour.size());
+        double MC = 1;
+        ScaleWeights Data;
+        Data.fill(1.);
+        for(size_t n = 0; n < pt.size(); ++n)
+            AddJet(pt[n], eta[n], csv[n], hadronFlavour[n], MC, Data);
+        return GetScaleWeights(MC, Data);
+    }
+
 private:
+    static void CheckJetColumns(size_t n_pt, size_t n_eta, size_t n_csv, size_t n_hadronFlavour)
+    {
+        if(n_eta != n_pt || n_csv != n_pt || n_hadronFlavour != n_pt)
+            throw exception("Inconsistent jet columns: n_pt = %1%, n_eta = %2%, n_csv = %3%, n_hadronFlavour = %4%.")
+                % n_pt % n_eta % n_csv % n_hadronFlavour;
+    }
+
+    // Each factor is computed in the same way as in GetBtagWeight.
+    void AddJet(double pt, double eta, double csv, int hadronFlavour, double& MC, ScaleWeights& Data) const
+    {
+        if(std::abs(eta) >= cuts::btag_2016::eta) return;
+        double SF[NumberOfScales];
+        const double eff = GetReader(hadronFlavour).EvalAllScales(pt, eta, SF);
+        const bool tagged = csv > csv_cut;
+        MC *= tagged ? eff : 1 - eff;
+        for(size_t scale = 0; scale < NumberOfScales; ++scale) {
+            const double eff_SF = eff * SF[scale];
+            Data[scale] *= tagged ? eff_SF : 1 - eff_SF;
+        }
+    }
 
-    static std::string GetUncertantyName(UncertaintyScale unc)
+    static ScaleWeights GetScaleWeights(double MC, const ScaleWeights& Data)
     {
-        std::string unc_name = ToString(unc);
-        std::transform(unc_name.begin(), unc_name.end(), unc_name.begin(), ::tolower);
-        return unc_name;
+        ScaleWeights weights;
+        for(size_t scale = 0; scale < NumberOfScales; ++scale)
+            weights[scale] = MC != 0 ? Data[scale] / MC : 0;
+        return weights;
     }
 
     static double GetBtagWeight(const JetInfoVector& jetInfos)
@@ -179,7 +248,7 @@ private:
         return MC != 0 ? Data/MC : 0;
     }
 
-    ReaderInfo& GetReader(int hadronFlavour) const
+    const ReaderInfo& GetReader(int hadronFlavour) const
     {
         static const int default_flavour = 0;
         int flavour = std::abs(hadronFlavour);
@@ -3,11 +3,16 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <functional>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
 #include "PileUpWeight.h"
 #include "LeptonWeights.h"
 #include "BTagWeight.h"
 #include "TopPtWeight.h"
 #include "WeightingMode.h"
+#include "WeightProviderRegistry.h"
 
 namespace analysis {
 namespace mc_corrections {
@@ -17,32 +22,32 @@ public:
     using ProviderPtr = std::shared_ptr<IWeightProvider>;
     using ProviderMap = std::map<WeightType, ProviderPtr>;
 
-    EventWeights(Period period, DiscriminatorWP btag_wp)
+    // Providers are constructed on the first request. If use_shared_providers is true, they are taken from the
+    // process-wide registry and shared with all other EventWeights instances that use the same correction data.
+    // Providers are not thread-safe, so sharing should be enabled only for instances used by the same thread.
+    EventWeights(Period period, DiscriminatorWP btag_wp, bool _use_shared_providers = false) :
+        use_shared_providers(_use_shared_providers)
     {
         if(period == Period::Run2015) {
-            providers[WeightType::PileUp] = std::make_shared<PileUpWeight>(
-                        FullName("reWeight_Fall.root"), "lumiWeights", 60, 0);
-            providers[WeightType::LeptonTrigIdIso] = std::make_shared<LeptonWeights>(
+            AddProvider<PileUpWeight>(WeightType::PileUp, FullName("reWeight_Fall.root"), "lumiWeights", 60, 0);
+            AddProvider<LeptonWeights>(WeightType::LeptonTrigIdIso,
                         FullLeptonName("Electron/Electron_IdIso0p10_eff.root"),
                         FullLeptonName("Electron/Electron_SingleEle_eff.root"),
                         FullLeptonName("Muon/Muon_IdIso0p1_fall15.root"),
                         FullLeptonName("Muon/Muon_IsoMu18_fall15.root"));
-            providers[WeightType::BTag] = std::make_shared<BTagWeight>(
-                        FullName("bTagEff_Loose.root"), FullName("CSVv2.csv"), btag_wp);
+            AddProvider<BTagWeight>(WeightType::BTag, FullName("bTagEff_Loose.root"), FullName("CSVv2.csv"), btag_wp);
         }
         else if(period == Period::Run2016) {
-            providers[WeightType::PileUp] = std::make_shared<PileUpWeight>(
-                        FullName("pileup_weight_600bins_Moriond17.root"), "pileup_weight", 60, 0);
-            providers[WeightType::LeptonTrigIdIso] = std::make_shared<LeptonWeights>(
+            AddProvider<PileUpWeight>(WeightType::PileUp, FullName("pileup_weight_600bins_Moriond17.root"),
+                                      "pileup_weight", 60, 0);
+            AddProvider<LeptonWeights>(WeightType::LeptonTrigIdIso,
                         FullLeptonName("Electron/Run2016BtoH/Electron_IdIso_IsoLt0p15_eff.root"),
                         FullLeptonName("Electron/Run2016BtoH/Electron_Ele25WPTight_eff.root"),
                         FullLeptonName("Muon/Run2016BtoH/Muon_IdIso_IsoLt0p2_2016BtoH_eff_update1407.root"),
                         FullLeptonName("Muon/Run2016BtoH/Muon_Mu22OR_eta2p1_eff.root"));
-            providers[WeightType::BTag] = std::make_shared<BTagWeight>(
-                        FullBtagName("bTagEfficiencies_Moriond17.root"), FullBtagName("CSVv2_Moriond17_B_H.csv"), btag_wp);
-			
-            providers[WeightType::TopPt] = std::make_shared<TopPtWeight>(0.0615, 0.0005);
-
+            AddProvider<BTagWeight>(WeightType::BTag, FullBtagName("bTagEfficiencies_Moriond17.root"),
+                                    FullBtagName("CSVv2_Moriond17_B_H.csv"), btag_wp);
+            AddProvider<TopPtWeight>(WeightType::TopPt, 0.0615, 0.0005);
         } else {
             throw exception("Period %1% is not supported.") % period;
         }
@@ -50,9 +55,15 @@ public:
 
     ProviderPtr GetProvider(WeightType weightType) const
     {
-        if(!providers.count(weightType))
+        auto iter = providers.find(weightType);
+        if(iter != providers.end())
+            return iter->second;
+        auto lazy_iter = lazyProviders.find(weightType);
+        if(lazy_iter == lazyProviders.end())
             throw exception("Weight provider not found for %1% weight.") % weightType;
-        return providers.at(weightType);
+        LazyProvider& lazy = *lazy_iter->second;
+        std::call_once(lazy.once_flag, [&]() { lazy.provider = lazy.factory(); });
+        return lazy.provider;
     }
 
     template<typename Provider>
@@ -80,6 +91,17 @@ public:
         return weight;
     }
 
+    // Event branches read by the providers of the given weights.
+    std::set<std::string> GetRequiredBranches(const WeightingMode& weightingMode) const
+    {
+        std::set<std::string> branches;
+        for(WeightType weightType : weightingMode) {
+            const auto provider_branches = GetProvider(weightType)->GetRequiredBranches();
+            branches.insert(provider_branches.begin(), provider_branches.end());
+        }
+        return branches;
+    }
+
 protected:
     static std::string FullName(const std::string& fileName, const std::string& path)
     {
@@ -104,8 +126,111 @@ protected:
         return FullName(fileName, path);
     }
 
+    template<typename Provider, typename... Args>
+    void AddProvider(WeightType weightType, const Args&... args)
+    {
+        const bool use_shared = use_shared_providers;
+        auto lazy = std::make_shared<LazyProvider>();
+        lazy->factory = [=]() -> ProviderPtr {
+            if(use_shared)
+                return WeightProviderRegistry::Global().Get<Provider>(args...);
+            return std::make_shared<Provider>(args...);
+        };
+        lazyProviders[weightType] = lazy;
+    }
+
+private:
+    struct LazyProvider {
+        std::function<ProviderPtr()> factory;
+        std::once_flag once_flag;
+        ProviderPtr provider;
+    };
+
 protected:
     ProviderMap providers;
+
+private:
+    bool use_shared_providers;
+    std::map<WeightType, std::shared_ptr<LazyProvider>> lazyProviders;
+};
+
+template<WeightType _weightType, typename _Provider>
+struct StaticWeight {
+    static constexpr WeightType weightType = _weightType;
+    using Provider = _Provider;
+};
+
+// Event weights with the set of providers fixed at compile time, e.g.
+//     StaticEventWeights<StaticWeight<WeightType::PileUp, PileUpWeight>, StaticWeight<WeightType::BTag, BTagWeight>>
+// Providers are called non-virtually, so their Get methods can be inlined into a single product. Weights should be
+// listed in the order of WeightType to produce the same total as EventWeights::GetTotalWeight. Other weighting modes
+// are evaluated by the runtime-configured EventWeights.
+template<typename... Weights>
+class StaticEventWeights {
+public:
+    using ProviderTuple = std::tuple<std::shared_ptr<typename Weights::Provider>...>;
+    static constexpr size_t NumberOfWeights = sizeof...(Weights);
+
+    explicit StaticEventWeights(std::shared_ptr<const EventWeights> _eventWeights) :
+        eventWeights(_eventWeights),
+        providers(eventWeights->GetProviderT<typename Weights::Provider>(Weights::weightType)...)
+    {
+        const std::vector<WeightType> weightTypes = { Weights::weightType... };
+        for(size_t n = 1; n < weightTypes.size(); ++n) {
+            if(weightTypes.at(n - 1) >= weightTypes.at(n))
+                throw exception("Static event weights should be listed in the increasing order of the weight type."
+                                " %1% is listed after %2%.") % weightTypes.at(n) % weightTypes.at(n - 1);
+        }
+    }
+
+    static const WeightingMode& GetWeightingMode()
+    {
+        static const WeightingMode weightingMode = { Weights::weightType... };
+        return weightingMode;
+    }
+
+    const EventWeights& GetEventWeights() const { return *eventWeights; }
+
+    template<typename Event>
+    double GetTotalWeight(const Event& event) const { return MultiplyWeights<0>(event, 1.); }
+
+    template<typename Event>
+    double GetTotalWeight(const Event& event, const WeightingMode& weightingMode) const
+    {
+        if(weightingMode == GetWeightingMode())
+            return GetTotalWeight(event);
+        return eventWeights->GetTotalWeight(event, weightingMode);
+    }
+
+    template<typename EventCollection>
+    void GetTotalWeights(const EventCollection& events, std::vector<double>& weights) const
+    {
+        weights.clear();
+        weights.reserve(events.size());
+        for(const auto& event : events)
+            weights.push_back(GetTotalWeight(event));
+    }
+
+private:
+    template<size_t index, typename Event>
+    typename std::enable_if<(index < NumberOfWeights), double>::type
+    MultiplyWeights(const Event& event, double weight) const
+    {
+        using ProviderPtr = typename std::tuple_element<index, ProviderTuple>::type;
+        using Provider = typename ProviderPtr::element_type;
+        return MultiplyWeights<index + 1>(event, weight * std::get<index>(providers)->Provider::Get(event));
+    }
+
+    template<size_t index, typename Event>
+    typename std::enable_if<(index == NumberOfWeights), double>::type
+    MultiplyWeights(const Event& /*event*/, double weight) const
+    {
+        return weight;
+    }
+
+private:
+    std::shared_ptr<const EventWeights> eventWeights;
+    ProviderTuple providers;
 };
 
 } // namespace mc_corrections
@@ -0,0 +1,124 @@
+/*! Read-only copies of ROOT histograms stored in contiguous arrays for the fast per-event lookup.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <TH1.h>
+#include <TH2.h>
+#include "AnalysisTools/Core/include/RootExt.h"
+
+namespace analysis {
+namespace mc_corrections {
+
+// Bin indices follow the ROOT convention: 0 is the underflow bin, 1..N are the normal bins and N+1 is the overflow bin.
+class FlatHistAxis {
+public:
+    FlatHistAxis() : n_bins(0), is_uniform(true), x_min(0), x_max(0) {}
+
+    explicit FlatHistAxis(const TAxis& axis) :
+        n_bins(static_cast<size_t>(axis.GetNbins())), is_uniform(!axis.GetXbins()->GetSize()),
+        x_min(axis.GetXmin()), x_max(axis.GetXmax())
+    {
+        for(size_t bin = 1; bin <= n_bins + 1; ++bin)
+            edges.push_back(axis.GetBinLowEdge(static_cast<int>(bin)));
+    }
+
+    size_t GetNbins() const { return n_bins; }
+
+    size_t FindBin(double x) const
+    {
+        if(!is_uniform)
+            return static_cast<size_t>(std::upper_bound(edges.begin(), edges.end(), x) - edges.begin());
+        if(!(x >= x_min)) return 0;
+        if(!(x < x_max)) return n_bins + 1;
+        return 1 + static_cast<size_t>(n_bins * (x - x_min) / (x_max - x_min));
+    }
+
+    // Values outside of the axis range are assigned to the first or the last normal bin.
+    size_t FindBinClamped(double x) const { return std::min(n_bins, std::max<size_t>(1, FindBin(x))); }
+
+private:
+    size_t n_bins;
+    bool is_uniform;
+    double x_min, x_max;
+    std::vector<double> edges;
+};
+
+namespace detail {
+template<typename Hist>
+std::unique_ptr<Hist> ReadHist(const std::string& file_name, const std::string& hist_name)
+{
+    auto file = root_ext::OpenRootFile(file_name);
+    return std::unique_ptr<Hist>(root_ext::ReadCloneObject<Hist>(*file, hist_name, "", true));
+}
+} // namespace detail
+
+class FlatHistLookup1D {
+public:
+    FlatHistLookup1D() {}
+
+    explicit FlatHistLookup1D(const TH1& hist) : x_axis(*hist.GetXaxis())
+    {
+        for(size_t bin = 0; bin <= x_axis.GetNbins() + 1; ++bin)
+            values.push_back(hist.GetBinContent(static_cast<int>(bin)));
+    }
+
+    static FlatHistLookup1D Load(const std::string& file_name, const std::string& hist_name)
+    {
+        return FlatHistLookup1D(*detail::ReadHist<TH1>(file_name, hist_name));
+    }
+
+    const FlatHistAxis& GetXaxis() const { return x_axis; }
+    size_t FindBin(double x) const { return x_axis.FindBin(x); }
+    double GetBinContent(size_t bin) const { return values.at(bin); }
+    double Get(double x) const { return values[x_axis.FindBin(x)]; }
+    double GetClamped(double x) const { return values[x_axis.FindBinClamped(x)]; }
+
+private:
+    FlatHistAxis x_axis;
+    std::vector<double> values;
+};
+
+class FlatHistLookup2D {
+public:
+    FlatHistLookup2D() : n_y(0) {}
+
+    explicit FlatHistLookup2D(const TH2& hist) :
+        x_axis(*hist.GetXaxis()), y_axis(*hist.GetYaxis()), n_y(y_axis.GetNbins() + 2)
+    {
+        for(size_t x_bin = 0; x_bin <= x_axis.GetNbins() + 1; ++x_bin) {
+            for(size_t y_bin = 0; y_bin < n_y; ++y_bin)
+                values.push_back(hist.GetBinContent(static_cast<int>(x_bin), static_cast<int>(y_bin)));
+        }
+    }
+
+    static FlatHistLookup2D Load(const std::string& file_name, const std::string& hist_name)
+    {
+        return FlatHistLookup2D(*detail::ReadHist<TH2>(file_name, hist_name));
+    }
+
+    const FlatHistAxis& GetXaxis() const { return x_axis; }
+    const FlatHistAxis& GetYaxis() const { return y_axis; }
+
+    double GetBinContent(size_t x_bin, size_t y_bin) const
+    {
+        if(y_bin >= n_y)
+            throw exception("Y bin %1% is out of range.") % y_bin;
+        return values.at(x_bin * n_y + y_bin);
+    }
+
+    double Get(double x, double y) const { return values[x_axis.FindBin(x) * n_y + y_axis.FindBin(y)]; }
+
+    double GetClamped(double x, double y) const
+    {
+        return values[x_axis.FindBinClamped(x) * n_y + y_axis.FindBinClamped(y)];
+    }
+
+private:
+    FlatHistAxis x_axis, y_axis;
+    size_t n_y;
+    std::vector<double> values;
+};
+
+} // namespace mc_corrections
+} // namespace analysis
@@ -27,11 +27,16 @@ class JetCorrectionUncertainty
     void setLepPz       (float fLepPz);
     void setAddLepToJet (bool fAddLepToJet) {mAddLepToJet = fAddLepToJet;}
     float getUncertainty(bool fDirection);
+    //---- Stateless version for the parametrizations that depend only on the jet eta and pt.
+    //---- It doesn't use the values given by the setters and can be called from multiple threads.
+    float getUncertainty(float fEta, float fPt, bool fDirection) const;
 
  private:
   JetCorrectionUncertainty(const JetCorrectionUncertainty&);
   JetCorrectionUncertainty& operator= (const JetCorrectionUncertainty&);
   std::vector<float> fillVector(const std::vector<std::string>& fNames);
+  static std::vector<float> fillVector(const std::vector<std::string>& fNames, float fEta, float fPt);
+  void initParametrization();
   float getPtRel();
   //---- Member Data ---------
   float mJetE;
@@ -51,6 +56,7 @@ class JetCorrectionUncertainty
   bool  mIsLepPxset;
   bool  mIsLepPyset;
   bool  mIsLepPzset;
+  bool  mIsEtaPtParametrization; // single bin variable JetEta and single parameter JetPt
   SimpleJetCorrectionUncertainty* mUncertainty;
 };
 
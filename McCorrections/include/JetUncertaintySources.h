@@ -0,0 +1,479 @@
+/*! Evaluation of all JES uncertainty sources at once.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AnalysisTools/Core/include/exception.h"
+
+namespace analysis {
+namespace mc_corrections {
+
+// Reads all sections of a JES uncertainty sources file, where each section is a source binned in JetEta and
+// parametrised in JetPt, and evaluates up and down uncertainties of all sources in a single call. Results are
+// identical to the per-source JetCorrectionUncertainty. All sources should share the same eta binning, and pt grids
+// that are identical between sources are searched only once per call.
+// If use_binary_cache is true, the parsed records are read from the binary file GetBinaryCacheName(file_name),
+// unless the size or the modification time of the text file differ from the ones stored in the cache. Otherwise the
+// text file is parsed and the binary cache is (re)written, if the directory is writable. The cache file is not meant
+// to be committed.
+class JetUncertaintySources {
+public:
+    explicit JetUncertaintySources(const std::string& file_name,
+                                   const std::vector<std::string>& selected_sources = {},
+                                   bool use_binary_cache = false)
+    {
+        const SourceMap all_sources = LoadSources(file_name, use_binary_cache, source_names);
+        if(!selected_sources.empty())
+            source_names = selected_sources;
+        if(source_names.empty())
+            throw exception("No JES uncertainty sources found in '%1%'.") % file_name;
+        for(const std::string& name : source_names) {
+            if(!all_sources.count(name))
+                throw exception("JES uncertainty source '%1%' not found in '%2%'.") % name % file_name;
+        }
+
+        const SourceData& first_source = all_sources.at(source_names.front());
+        for(const Record& record : first_source.records) {
+            eta_min.push_back(record.eta_min);
+            eta_max.push_back(record.eta_max);
+        }
+        for(size_t n = 1; n < eta_min.size(); ++n) {
+            if(eta_min.at(n) < eta_max.at(n - 1))
+                throw exception("Overlapping eta bins in JES uncertainty source '%1%'.") % source_names.front();
+        }
+
+        entries.resize(eta_min.size() * source_names.size());
+        for(size_t source_id = 0; source_id < source_names.size(); ++source_id) {
+            const std::string& name = source_names.at(source_id);
+            const SourceData& source = all_sources.at(name);
+            if(source.records.size() != eta_min.size())
+                throw exception("Eta binning of JES uncertainty source '%1%' differs from '%2%'.")
+                    % name % source_names.front();
+            for(size_t eta_bin = 0; eta_bin < eta_min.size(); ++eta_bin) {
+                const Record& record = source.records.at(eta_bin);
+                if(record.eta_min != eta_min.at(eta_bin) || record.eta_max != eta_max.at(eta_bin))
+                    throw exception("Eta binning of JES uncertainty source '%1%' differs from '%2%'.")
+                        % name % source_names.front();
+                Entry& entry = entries.at(eta_bin * source_names.size() + source_id);
+                entry.grid_id = AddGrid(record.pt);
+                entry.value_offset = up_values.size();
+                up_values.insert(up_values.end(), record.up.begin(), record.up.end());
+                down_values.insert(down_values.end(), record.down.begin(), record.down.end());
+            }
+        }
+    }
+
+    static std::string GetBinaryCacheName(const std::string& file_name) { return file_name + ".bin"; }
+
+    size_t GetNumberOfSources() const { return source_names.size(); }
+    const std::vector<std::string>& GetSourceNames() const { return source_names; }
+
+    size_t GetSourceIndex(const std::string& name) const
+    {
+        const auto iter = std::find(source_names.begin(), source_names.end(), name);
+        if(iter == source_names.end())
+            throw exception("JES uncertainty source '%1%' not found.") % name;
+        return static_cast<size_t>(iter - source_names.begin());
+    }
+
+    // Writes uncertainties of all sources into the up and down arrays, each of GetNumberOfSources() size.
+    // If eta is out of range, the arrays are filled with -999, as done by JetCorrectionUncertainty, and false
+    // is returned.
+    bool Evaluate(float eta, float pt, float* up, float* down) const
+    {
+        const size_t n_sources = source_names.size();
+        const int eta_bin = static_cast<int>(std::upper_bound(eta_min.begin(), eta_min.end(), eta)
+                                             - eta_min.begin()) - 1;
+        if(eta_bin < 0 || !(eta < eta_max[eta_bin])) {
+            std::fill(up, up + n_sources, -999.f);
+            std::fill(down, down + n_sources, -999.f);
+            return false;
+        }
+
+        const Entry* bin_entries = &entries[eta_bin * n_sources];
+        size_t current_grid_id = grids.size();
+        Interval interval;
+        for(size_t n = 0; n < n_sources; ++n) {
+            const Entry& entry = bin_entries[n];
+            if(entry.grid_id != current_grid_id) {
+                interval = FindInterval(grids[entry.grid_id], pt);
+                current_grid_id = entry.grid_id;
+            }
+            up[n] = Interpolate(interval, &up_values[entry.value_offset], pt);
+            down[n] = Interpolate(interval, &down_values[entry.value_offset], pt);
+        }
+        return true;
+    }
+
+private:
+    struct Record {
+        float eta_min, eta_max;
+        std::vector<float> pt, up, down;
+    };
+
+    struct SourceData {
+        std::vector<Record> records;
+    };
+
+    using SourceMap = std::map<std::string, SourceData>;
+
+    struct Grid {
+        size_t offset, size;
+    };
+
+    struct Entry {
+        size_t grid_id, value_offset;
+    };
+
+    // Position of pt on the grid: index of the first node of the interpolation interval or one of the boundaries.
+    struct Interval {
+        enum class Type { Empty, Below, Above, Inside };
+        Type type;
+        size_t index;
+        float x[2];
+    };
+
+    static SourceMap LoadSources(const std::string& file_name, bool use_binary_cache,
+                                 std::vector<std::string>& section_names)
+    {
+        if(!use_binary_cache)
+            return ReadTextFile(file_name, section_names);
+        FileStamp stamp;
+        if(!GetFileStamp(file_name, stamp))
+            return ReadTextFile(file_name, section_names);
+        const std::string cache_name = GetBinaryCacheName(file_name);
+        SourceMap sources;
+        if(ReadBinaryFile(cache_name, stamp, sources, section_names))
+            return sources;
+        section_names.clear();
+        sources = ReadTextFile(file_name, section_names);
+        WriteBinaryFile(cache_name, stamp, sources, section_names);
+        return sources;
+    }
+
+    // Size and modification time of the text file. The cache is valid only if they are exactly the same as when
+    // the cache was written, which does not depend on the timestamp resolution of the file system.
+    struct FileStamp {
+        uint64_t size;
+        int64_t mtime_sec, mtime_nsec;
+
+        bool operator==(const FileStamp& other) const
+        {
+            return size == other.size && mtime_sec == other.mtime_sec && mtime_nsec == other.mtime_nsec;
+        }
+    };
+
+    static bool GetFileStamp(const std::string& file_name, FileStamp& stamp)
+    {
+        struct stat file_stat;
+        if(stat(file_name.c_str(), &file_stat) != 0)
+            return false;
+        stamp.size = static_cast<uint64_t>(file_stat.st_size);
+        stamp.mtime_sec = static_cast<int64_t>(file_stat.st_mtime);
+#ifdef __APPLE__
+        stamp.mtime_nsec = static_cast<int64_t>(file_stat.st_mtimespec.tv_nsec);
+#else
+        stamp.mtime_nsec = static_cast<int64_t>(file_stat.st_mtim.tv_nsec);
+#endif
+        return true;
+    }
+
+    // Binary format: magic, version, size and modification time of the text file, number of sections and, for each
+    // section, its name and records with eta_min, eta_max, number of points and pt, up and down arrays. Native byte
+    // order is used, since the cache is created on the same machine.
+    static constexpr uint32_t BinaryMagic = 0x4A555342, BinaryVersion = 2;
+
+    class BinaryReader {
+    public:
+        explicit BinaryReader(std::vector<char>&& _data) : data(std::move(_data)), pos(0) {}
+
+        template<typename T>
+        bool Read(T* values, size_t n = 1)
+        {
+            const size_t size = sizeof(T) * n;
+            if(data.size() - pos < size) return false;
+            if(size)
+                std::memcpy(values, data.data() + pos, size);
+            pos += size;
+            return true;
+        }
+
+        bool ReadSize(size_t& value, size_t max_value)
+        {
+            uint64_t v;
+            if(!Read(&v) || v > max_value) return false;
+            value = static_cast<size_t>(v);
+            return true;
+        }
+
+        size_t Remaining() const { return data.size() - pos; }
+
+    private:
+        std::vector<char> data;
+        size_t pos;
+    };
+
+    static bool ReadBinaryFile(const std::string& cache_name, const FileStamp& stamp, SourceMap& sources,
+                               std::vector<std::string>& section_names)
+    {
+        std::ifstream file(cache_name, std::ios::binary | std::ios::ate);
+        if(!file.is_open()) return false;
+        const std::streamoff file_size = file.tellg();
+        if(file_size < 0) return false;
+        std::vector<char> data(static_cast<size_t>(file_size));
+        file.seekg(0);
+        if(!file.read(data.data(), file_size)) return false;
+        BinaryReader reader(std::move(data));
+        uint32_t magic, version;
+        FileStamp cache_stamp;
+        size_t n_sections;
+        if(!reader.Read(&magic) || magic != BinaryMagic || !reader.Read(&version) || version != BinaryVersion
+                || !reader.Read(&cache_stamp.size) || !reader.Read(&cache_stamp.mtime_sec)
+                || !reader.Read(&cache_stamp.mtime_nsec) || !(cache_stamp == stamp)
+                || !reader.ReadSize(n_sections, reader.Remaining()))
+            return false;
+        std::vector<std::string> names;
+        SourceMap result;
+        for(size_t section_id = 0; section_id < n_sections; ++section_id) {
+            size_t name_size, n_records;
+            if(!reader.ReadSize(name_size, reader.Remaining())) return false;
+            std::string name(name_size, ' ');
+            if(!reader.Read(&name[0], name_size) || result.count(name)
+                    || !reader.ReadSize(n_records, reader.Remaining()))
+                return false;
+            auto& records = result[name].records;
+            records.resize(n_records);
+            for(Record& record : records) {
+                size_t n_points;
+                if(!reader.Read(&record.eta_min) || !reader.Read(&record.eta_max)
+                        || !reader.ReadSize(n_points, reader.Remaining() / sizeof(float)))
+                    return false;
+                record.pt.resize(n_points);
+                record.up.resize(n_points);
+                record.down.resize(n_points);
+                if(!reader.Read(record.pt.data(), n_points) || !reader.Read(record.up.data(), n_points)
+                        || !reader.Read(record.down.data(), n_points))
+                    return false;
+            }
+            names.push_back(name);
+        }
+        if(reader.Remaining()) return false;
+        sources = std::move(result);
+        section_names = std::move(names);
+        return true;
+    }
+
+    // The cache is written into a temporary file that is renamed at the end, so that concurrent jobs never read
+    // a partially written cache. Failures to write the cache are ignored.
+    static void WriteBinaryFile(const std::string& cache_name, const FileStamp& stamp, const SourceMap& sources,
+                                const std::vector<std::string>& section_names)
+    {
+        std::ostringstream tmp_name;
+        tmp_name << cache_name << ".tmp" << getpid();
+        {
+            std::ofstream file(tmp_name.str(), std::ios::binary);
+            if(!file.is_open()) return;
+            const auto write = [&](const void* data, size_t size) {
+                file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            };
+            const auto write_size = [&](size_t value) {
+                const uint64_t v = value;
+                write(&v, sizeof(v));
+            };
+            const uint32_t magic = BinaryMagic, version = BinaryVersion;
+            write(&magic, sizeof(magic));
+            write(&version, sizeof(version));
+            write(&stamp.size, sizeof(stamp.size));
+            write(&stamp.mtime_sec, sizeof(stamp.mtime_sec));
+            write(&stamp.mtime_nsec, sizeof(stamp.mtime_nsec));
+            write_size(section_names.size());
+            for(const std::string& name : section_names) {
+                write_size(name.size());
+                write(name.data(), name.size());
+                const auto& records = sources.at(name).records;
+                write_size(records.size());
+                for(const Record& record : records) {
+                    write(&record.eta_min, sizeof(float));
+                    write(&record.eta_max, sizeof(float));
+                    write_size(record.pt.size());
+                    write(record.pt.data(), sizeof(float) * record.pt.size());
+                    write(record.up.data(), sizeof(float) * record.up.size());
+                    write(record.down.data(), sizeof(float) * record.down.size());
+                }
+            }
+            if(!file.good()) {
+                file.close();
+                std::remove(tmp_name.str().c_str());
+                return;
+            }
+        }
+        if(std::rename(tmp_name.str().c_str(), cache_name.c_str()) != 0)
+            std::remove(tmp_name.str().c_str());
+    }
+
+    static SourceMap ReadTextFile(const std::string& file_name, std::vector<std::string>& section_names)
+    {
+        std::ifstream file(file_name);
+        if(!file.is_open())
+            throw exception("Unable to open JES uncertainty sources file '%1%'.") % file_name;
+
+        SourceMap sources;
+        std::string line, section;
+        while(std::getline(file, line)) {
+            const size_t first = line.find_first_not_of(" \t\r");
+            if(first == std::string::npos || line.at(first) == '#') continue;
+            if(line.at(first) == '[') {
+                const size_t last = line.find(']', first);
+                if(last == std::string::npos)
+                    throw exception("Invalid section line '%1%' in '%2%'.") % line % file_name;
+                section = line.substr(first + 1, last - first - 1);
+                if(sources.count(section))
+                    throw exception("Duplicated section '%1%' in '%2%'.") % section % file_name;
+                section_names.push_back(section);
+                sources[section];
+                continue;
+            }
+            if(line.at(first) == '{') {
+                CheckDefinitions(line, file_name);
+                continue;
+            }
+            if(section.empty())
+                throw exception("Record outside of any section in '%1%'.") % file_name;
+            Record record;
+            if(ParseRecord(line, record, file_name))
+                sources[section].records.push_back(record);
+        }
+
+        for(auto& source : sources) {
+            auto& records = source.second.records;
+            std::stable_sort(records.begin(), records.end(),
+                             [](const Record& r1, const Record& r2) { return r1.eta_min < r2.eta_min; });
+        }
+        return sources;
+    }
+
+    static void CheckDefinitions(const std::string& line, const std::string& file_name)
+    {
+        const size_t first = line.find('{'), last = line.find('}');
+        if(last == std::string::npos)
+            throw exception("Invalid definitions line '%1%' in '%2%'.") % line % file_name;
+        std::istringstream ss(line.substr(first + 1, last - first - 1));
+        std::string n_bin_vars, bin_var, n_par_vars, par_var;
+        ss >> n_bin_vars >> bin_var >> n_par_vars >> par_var;
+        if(n_bin_vars != "1" || bin_var != "JetEta" || n_par_vars != "1" || par_var != "JetPt")
+            throw exception("Unsupported JES uncertainty parametrisation '%1%' in '%2%'.") % line % file_name;
+    }
+
+    // Returns false for the records that are skipped by JetCorrectorParameters.
+    static bool ParseRecord(const std::string& line, Record& record, const std::string& file_name)
+    {
+        std::istringstream ss(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while(ss >> token)
+            tokens.push_back(token);
+        if(tokens.size() < 3)
+            throw exception("Invalid record '%1%' in '%2%'.") % line % file_name;
+        record.eta_min = ParseFloat(tokens.at(0), line, file_name);
+        record.eta_max = ParseFloat(tokens.at(1), line, file_name);
+        const size_t n_parameters = static_cast<size_t>(ParseFloat(tokens.at(2), line, file_name));
+        if((record.eta_min == 0 && record.eta_max == 0) || n_parameters == 0) return false;
+        if(n_parameters != tokens.size() - 3)
+            throw exception("Invalid number of parameters in record '%1%' in '%2%'.") % line % file_name;
+        if(n_parameters % 3 != 0)
+            throw exception("Number of parameters in record '%1%' in '%2%' is not a multiple of 3.")
+                % line % file_name;
+        for(size_t n = 3; n < tokens.size(); n += 3) {
+            const float pt = ParseFloat(tokens.at(n), line, file_name);
+            if(!record.pt.empty() && pt < record.pt.back())
+                throw exception("Unsorted pt grid in record '%1%' in '%2%'.") % line % file_name;
+            record.pt.push_back(pt);
+            record.up.push_back(ParseFloat(tokens.at(n + 1), line, file_name));
+            record.down.push_back(ParseFloat(tokens.at(n + 2), line, file_name));
+        }
+        return true;
+    }
+
+    // Uncertainty files can contain "nan" values, which are not parsed by the stream operators.
+    static float ParseFloat(const std::string& token, const std::string& line, const std::string& file_name)
+    {
+        char* end;
+        const float value = std::strtof(token.c_str(), &end);
+        if(end == token.c_str() || *end != '\0')
+            throw exception("Invalid value '%1%' in record '%2%' in '%3%'.") % token % line % file_name;
+        return value;
+    }
+
+    size_t AddGrid(const std::vector<float>& pt)
+    {
+        for(size_t grid_id = 0; grid_id < grids.size(); ++grid_id) {
+            const Grid& grid = grids.at(grid_id);
+            if(grid.size == pt.size() && std::equal(pt.begin(), pt.end(), pt_nodes.begin() + grid.offset))
+                return grid_id;
+        }
+        grids.push_back(Grid{pt_nodes.size(), pt.size()});
+        pt_nodes.insert(pt_nodes.end(), pt.begin(), pt.end());
+        return grids.size() - 1;
+    }
+
+    Interval FindInterval(const Grid& grid, float pt) const
+    {
+        Interval interval;
+        interval.index = 0;
+        const float* nodes = &pt_nodes[grid.offset];
+        if(grid.size == 0)
+            interval.type = Interval::Type::Empty;
+        else if(pt <= nodes[0])
+            interval.type = Interval::Type::Below;
+        else if(pt >= nodes[grid.size - 1]) {
+            interval.type = Interval::Type::Above;
+            interval.index = grid.size - 1;
+        } else {
+            interval.type = Interval::Type::Inside;
+            interval.index = static_cast<size_t>(std::upper_bound(nodes, nodes + grid.size - 1, pt) - nodes) - 1;
+            interval.x[0] = nodes[interval.index];
+            interval.x[1] = nodes[interval.index + 1];
+        }
+        return interval;
+    }
+
+    // Same arithmetic as in SimpleJetCorrectionUncertainty::uncertaintyBin.
+    static float Interpolate(const Interval& interval, const float* values, float pt)
+    {
+        switch(interval.type) {
+            case Interval::Type::Empty: return -999.f;
+            case Interval::Type::Below: return values[0];
+            case Interval::Type::Above: return values[interval.index];
+            case Interval::Type::Inside: break;
+        }
+        const float* x = interval.x;
+        const float* y = values + interval.index;
+        if(x[0] == x[1])
+            return y[0] == y[1] ? y[0] : -999.f;
+        const float a = (y[1] - y[0]) / (x[1] - x[0]);
+        const float b = (y[0] * x[1] - y[1] * x[0]) / (x[1] - x[0]);
+        return a * pt + b;
+    }
+
+private:
+    std::vector<std::string> source_names;
+    std::vector<float> eta_min, eta_max;
+    std::vector<Entry> entries; // index: eta_bin * n_sources + source_id
+    std::vector<Grid> grids;
+    std::vector<float> pt_nodes, up_values, down_values;
+};
+
+} // namespace mc_corrections
+} // namespace analysis
@@ -5,6 +5,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #include "HTT-utilities/LepEffInterface/interface/ScaleFactor.h"
 #include "h-tautau/Analysis/include/AnalysisTypes.h"
+#include "FlatHistLookup.h"
 #include "WeightProvider.h"
 
 namespace analysis {
@@ -43,9 +44,6 @@ private:
 
 class MuonScaleFactorPOG {
 public:
-    using Hist = TH1;
-    using HistPtr = std::shared_ptr<Hist>;
-
     MuonScaleFactorPOG(const std::string& idInput_B_F, const std::string& isoInput_B_F,
                        const std::string& triggerInput_B_F, const std::string& idInput_G_H,
                        const std::string& isoInput_G_H, const std::string& triggerInput_G_H) :
@@ -57,63 +55,41 @@ public:
         trigger_hist_G_H(LoadWeight(triggerInput_G_H,"IsoMu24_OR_IsoTkMu24_PtEtaBins/pt_abseta_ratio")),
         lumi_B_F(19.72), lumi_G_H(15.931)
     {
-//        file_idInput_B_F = new TFile(idInput_B_F, "read");
     }
 
     template<typename LorentzVector>
-    double GetIdSF(const LorentzVector& p4) const
-    {
-//        TH2F* hist_B_F = (TH2F*)file_idInput_B_F->Get("MC_NUM_TightID_DEN_genTracks_PAR_pt_eta/pt_abseta_ratio");
-        const Int_t bin_pt_B_F = id_hist_B_F->GetXaxis()->FindBin(p4.pt());
-        const Int_t bin_eta_B_F = id_hist_B_F->GetYaxis()->FindBin(std::abs(p4.eta()));
-        double sf_B_F = id_hist_B_F->GetBinContent(bin_pt_B_F,bin_eta_B_F);
-
-        const Int_t bin_pt_G_H = id_hist_G_H->GetXaxis()->FindBin(p4.pt());
-        const Int_t bin_eta_G_H = id_hist_G_H->GetYaxis()->FindBin(std::abs(p4.eta()));
-        double sf_G_H = id_hist_G_H->GetBinContent(bin_pt_G_H,bin_eta_G_H);
-
-        return ((sf_B_F * lumi_B_F) + (sf_G_H * lumi_G_H))/(lumi_B_F + lumi_G_H);
-    }
+    double GetIdSF(const LorentzVector& p4) const { return GetLumiAveragedSF(id_hist_B_F, id_hist_G_H, p4); }
 
     template<typename LorentzVector>
-    double GetIsoSF(const LorentzVector& p4) const
-    {
-        const Int_t bin_pt_B_F = iso_hist_B_F->GetXaxis()->FindBin(p4.pt());
-        const Int_t bin_eta_B_F = iso_hist_B_F->GetYaxis()->FindBin(std::abs(p4.eta()));
-        double sf_B_F = iso_hist_B_F->GetBinContent(bin_pt_B_F,bin_eta_B_F);
-
-        const Int_t bin_pt_G_H = iso_hist_G_H->GetXaxis()->FindBin(p4.pt());
-        const Int_t bin_eta_G_H = iso_hist_G_H->GetYaxis()->FindBin(std::abs(p4.eta()));
-        double sf_G_H = iso_hist_G_H->GetBinContent(bin_pt_G_H,bin_eta_G_H);
-
-        return ((sf_B_F * lumi_B_F) + (sf_G_H * lumi_G_H))/(lumi_B_F + lumi_G_H);
-    }
+    double GetIsoSF(const LorentzVector& p4) const { return GetLumiAveragedSF(iso_hist_B_F, iso_hist_G_H, p4); }
 
     template<typename LorentzVector>
     double GetTriggerSF(const LorentzVector& p4) const
     {
-        const Int_t bin_pt_B_F = trigger_hist_B_F->GetXaxis()->FindBin(p4.pt());
-        const Int_t bin_eta_B_F = trigger_hist_B_F->GetYaxis()->FindBin(std::abs(p4.eta()));
-        double sf_B_F = trigger_hist_B_F->GetBinContent(bin_pt_B_F,bin_eta_B_F);
-
-        const Int_t bin_pt_G_H = trigger_hist_G_H->GetXaxis()->FindBin(p4.pt());
-        const Int_t bin_eta_G_H = trigger_hist_G_H->GetYaxis()->FindBin(std::abs(p4.eta()));
-        double sf_G_H = trigger_hist_G_H->GetBinContent(bin_pt_G_H,bin_eta_G_H);
-
-        return ((sf_B_F * lumi_B_F) + (sf_G_H * lumi_G_H))/(lumi_B_F + lumi_G_H);
+        return GetLumiAveragedSF(trigger_hist_B_F, trigger_hist_G_H, p4);
     }
 
     template<typename LorentzVector>
     double GetTotalSF(const LorentzVector& p4) const { return GetIdSF(p4) * GetIsoSF(p4) * GetTriggerSF(p4); }
 
-    static HistPtr LoadWeight(const std::string& weight_file_name, const std::string& hist_name)
+    static FlatHistLookup2D LoadWeight(const std::string& weight_file_name, const std::string& hist_name)
+    {
+        return FlatHistLookup2D::Load(weight_file_name, hist_name);
+    }
+
+private:
+    template<typename LorentzVector>
+    double GetLumiAveragedSF(const FlatHistLookup2D& hist_B_F, const FlatHistLookup2D& hist_G_H,
+                             const LorentzVector& p4) const
     {
-        auto file = root_ext::OpenRootFile(weight_file_name);
-        return HistPtr(root_ext::ReadCloneObject<Hist>(*file, hist_name, "", true));
+        const double pt = p4.pt(), abs_eta = std::abs(p4.eta());
+        const double sf_B_F = hist_B_F.Get(pt, abs_eta);
+        const double sf_G_H = hist_G_H.Get(pt, abs_eta);
+        return ((sf_B_F * lumi_B_F) + (sf_G_H * lumi_G_H))/(lumi_B_F + lumi_G_H);
     }
 
 private:
-    HistPtr id_hist_B_F, id_hist_G_H, iso_hist_B_F, iso_hist_G_H, trigger_hist_B_F, trigger_hist_G_H;
+    FlatHistLookup2D id_hist_B_F, id_hist_G_H, iso_hist_B_F, iso_hist_G_H, trigger_hist_B_F, trigger_hist_G_H;
     double lumi_B_F, lumi_G_H;
 
 };
@@ -154,6 +130,8 @@ public:
         throw exception("ExpressEvent is not supported in LeptonWeights::Get.");
     }
 
+    virtual std::set<std::string> GetRequiredBranches() const override { return { "channelId", "p4_1" }; }
+
 private:
     detail::LeptonScaleFactors electronSF, muonSF;
 //    detail::MuonScaleFactorPOG muonSF;
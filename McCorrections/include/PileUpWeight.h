@@ -3,7 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
-#include "AnalysisTools/Core/include/RootExt.h"
+#include "FlatHistLookup.h"
 #include "WeightProvider.h"
 
 namespace analysis {
@@ -12,37 +12,48 @@ namespace mc_corrections {
 class PileUpWeight : public IWeightProvider {
 public:
     using Event = ntuple::Event;
-    using Hist = TH1;
-    using HistPtr = std::shared_ptr<Hist>;
 
     PileUpWeight(const std::string& pu_reweight_file_name, const std::string& hist_name, double _max_available_pu,
                  double _default_pu_weight) :
         max_available_pu(_max_available_pu), default_pu_weight(_default_pu_weight),
-        pu_weights(LoadPUWeights(pu_reweight_file_name, hist_name)) { }
+        pu_weights(FlatHistLookup1D::Load(pu_reweight_file_name, hist_name)),
+        max_bin(pu_weights.FindBin(max_available_pu)) { }
 
     virtual double Get(const Event& event) const override { return GetT(event); }
     virtual double Get(const ntuple::ExpressEvent& event) const override { return GetT(event); }
+    virtual std::set<std::string> GetRequiredBranches() const override { return { "npu" }; }
+
+    virtual void GetBatch(const Event* events, size_t n_events, double* weights) const override
+    {
+        GetBatchT(events, n_events, weights);
+    }
+
+    virtual void GetBatch(const ntuple::ExpressEvent* events, size_t n_events, double* weights) const override
+    {
+        GetBatchT(events, n_events, weights);
+    }
 
 private:
-	template<typename Event>
-    double GetT(const Event& event) const
+    template<typename Event>
+    void GetBatchT(const Event* events, size_t n_events, double* weights) const
     {
-        const double nPU = event.npu;
-        const Int_t bin = pu_weights->FindBin(nPU);
-        const Int_t maxBin = pu_weights->FindBin(max_available_pu);
-        const bool goodBin = bin >= 1 && bin <= maxBin;
-        return goodBin ? pu_weights->GetBinContent(bin) : default_pu_weight;
+        for(size_t n = 0; n < n_events; ++n)
+            weights[n] = GetT(events[n]);
     }
 
-    static HistPtr LoadPUWeights(const std::string& pu_reweight_file_name, const std::string& hist_name)
+	template<typename Event>
+    double GetT(const Event& event) const
     {
-        auto file = root_ext::OpenRootFile(pu_reweight_file_name);
-        return HistPtr(root_ext::ReadCloneObject<Hist>(*file, hist_name, "", true));
+        const double nPU = event.npu;
+        const size_t bin = pu_weights.FindBin(nPU);
+        const bool goodBin = bin >= 1 && bin <= max_bin;
+        return goodBin ? pu_weights.GetBinContent(bin) : default_pu_weight;
     }
 
 private:
     double max_available_pu, default_pu_weight;
-    HistPtr pu_weights;
+    FlatHistLookup1D pu_weights;
+    size_t max_bin;
 };
 
 } // namespace mc_corrections
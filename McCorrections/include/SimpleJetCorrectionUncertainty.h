@@ -16,14 +16,30 @@ class SimpleJetCorrectionUncertainty
   ~SimpleJetCorrectionUncertainty();
   const JetCorrectorParameters& parameters() const {return *mParameters;}
   float uncertainty(const std::vector<float>& fX, float fY, bool fDirection) const;
+  // same as above for the parametrizations with a single bin variable
+  float uncertainty(float fX, float fY, bool fDirection) const;
 
  private:
   SimpleJetCorrectionUncertainty(const SimpleJetCorrectionUncertainty&);
   SimpleJetCorrectionUncertainty& operator= (const SimpleJetCorrectionUncertainty&);
-  int findBin(const std::vector<float>& v, float x) const;
+  void initGrids();
+  int findRecord(float fX) const;
+  int findBin(const float* v, unsigned n, float x) const;
   float uncertaintyBin(unsigned fBin, float fY, bool fDirection) const;
   float linearInterpolation (float fZ, const float fX[2], const float fY[2]) const;
   JetCorrectorParameters* mParameters;
+  //---- Grids of all records, split at construction time ---------
+  //---- points of the record i are [mGridOffsets[i], mGridOffsets[i+1]) ---
+  std::vector<unsigned> mGridOffsets;
+  std::vector<unsigned> mNParameters;
+  std::vector<float> mYGrid;
+  std::vector<float> mUpValues;
+  std::vector<float> mDownValues;
+  bool mSortedGrids;
+  //---- Ranges of the single bin variable, if records are sorted and don't overlap ---
+  std::vector<float> mXMin;
+  std::vector<float> mXMax;
+  bool mUseBinarySearch;
 };
 
 #endif
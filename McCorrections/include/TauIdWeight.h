@@ -69,9 +69,11 @@ public:
 
         double EvaluateEfficiency(double pt) const
         {
-            return pt < 1000 ? crystalball(pt, m_0, sigma, alpha, n, norm) : 1;
+            return pt < MaxPt ? EvaluateCrystalBall(pt) : 1;
         }
 
+        double EvaluateCrystalBall(double pt) const { return crystalball(pt, m_0, sigma, alpha, n, norm); }
+
         static Parameters Parse(const ptree& entry)
         {
             Parameters parameters;
@@ -86,7 +88,14 @@ public:
         }
     };
 
-    TauIdWeight(const std::string& tauId_input, DiscriminatorWP _iso_wp) : iso_wp(_iso_wp)
+    // Efficiencies are parametrised up to MaxPt and are equal to 1 above it.
+    static constexpr double MaxPt = 1000;
+    static constexpr size_t NumberOfTableBins = 20000;
+
+    // If use_sf_tables is true, data/MC SFs are tabulated on the uniform pt grid in [0, MaxPt] for each available
+    // (genuine, decay mode) combination of the selected working point and are linearly interpolated.
+    TauIdWeight(const std::string& tauId_input, DiscriminatorWP _iso_wp, bool use_sf_tables = false) :
+        iso_wp(_iso_wp)
     {
         ptree property_tree;
         boost::property_tree::json_parser::read_json(tauId_input, property_tree);
@@ -94,6 +103,8 @@ public:
             const Key key = Key::Parse(type_entry.first);
             tauIdparam_map[key] = Parameters::Parse(type_entry.second);
         }
+        if(use_sf_tables)
+            CreateSFTables();
     }
 
     virtual double Get(const Event& event) const override
@@ -110,10 +121,33 @@ public:
         throw exception("ExpressEvent is not supported in TauIdWeight::Get.");
     }
 
+    virtual std::set<std::string> GetRequiredBranches() const override
+    {
+        return { "channelId", "p4_1", "p4_2", "gen_match_1", "gen_match_2", "decayMode_1", "decayMode_2" };
+    }
+
+    using IWeightProvider::GetBatch;
+
+    virtual void GetBatch(const Event* events, size_t n_events, double* weights) const override
+    {
+        for(size_t n = 0; n < n_events; ++n)
+            weights[n] = TauIdWeight::Get(events[n]);
+    }
+
 private:
     double EvaluateSF(double pt, GenMatch gen_match, int decay_mode) const
     {
         const bool is_genuine = gen_match == GenMatch::Tau;
+        const size_t table_index = GetTableIndex(is_genuine, decay_mode);
+        if(table_index < sf_tables.size() && !sf_tables[table_index].empty() && pt >= 0) {
+            if(pt >= MaxPt) return 1.;
+            const std::vector<double>& table = sf_tables[table_index];
+            const double x = pt / MaxPt * NumberOfTableBins;
+            const size_t bin = std::min(static_cast<size_t>(x), NumberOfTableBins - 1);
+            const double f = x - bin;
+            return table[bin] + f * (table[bin + 1] - table[bin]);
+        }
+
         const double eff_data = EvaluateEfficiency(pt, true, is_genuine, decay_mode);
         const double eff_mc = EvaluateEfficiency(pt, false, is_genuine, decay_mode);
         return eff_data / eff_mc;
@@ -130,8 +164,40 @@ private:
         return iter->second.EvaluateEfficiency(pt);
     }
 
+    static size_t GetTableIndex(bool is_genuine, int decay_mode)
+    {
+        if(decay_mode < 0) return std::numeric_limits<size_t>::max();
+        return static_cast<size_t>(decay_mode) * 2 + (is_genuine ? 1 : 0);
+    }
+
+    void CreateSFTables()
+    {
+        for(const auto& entry : tauIdparam_map) {
+            const Key& data_key = entry.first;
+            if(!data_key.isData || data_key.isowp != iso_wp || data_key.decayMode < 0) continue;
+            const Key mc_key{false, data_key.isGenuineTau, data_key.isowp, data_key.decayMode};
+            auto mc_iter = tauIdparam_map.find(mc_key);
+            if(mc_iter == tauIdparam_map.end()) continue;
+            const Parameters& data_param = entry.second;
+            const Parameters& mc_param = mc_iter->second;
+
+            const size_t table_index = GetTableIndex(data_key.isGenuineTau, data_key.decayMode);
+            if(table_index >= sf_tables.size())
+                sf_tables.resize(table_index + 1);
+            std::vector<double>& table = sf_tables[table_index];
+            table.resize(NumberOfTableBins + 1);
+            for(size_t n = 0; n < NumberOfTableBins; ++n) {
+                const double pt = MaxPt * n / NumberOfTableBins;
+                table[n] = data_param.EvaluateEfficiency(pt) / mc_param.EvaluateEfficiency(pt);
+            }
+            // The last node is the limit from below, since SF is discontinuous at MaxPt.
+            table[NumberOfTableBins] = data_param.EvaluateCrystalBall(MaxPt) / mc_param.EvaluateCrystalBall(MaxPt);
+        }
+    }
+
     std::map<Key, Parameters> tauIdparam_map;
     DiscriminatorWP iso_wp;
+    std::vector<std::vector<double>> sf_tables; // index: GetTableIndex(is_genuine, decay_mode)
 
 };
 
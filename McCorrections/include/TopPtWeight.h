@@ -37,6 +37,23 @@ public:
         return sf_1 * sf_2;
     }
 
+    virtual std::set<std::string> GetRequiredBranches() const override
+    {
+        return { "genParticles_pdg", "genParticles_p4" };
+    }
+
+    virtual void GetBatch(const Event* events, size_t n_events, double* weights) const override
+    {
+        for(size_t n = 0; n < n_events; ++n)
+            weights[n] = TopPtWeight::Get(events[n]);
+    }
+
+    virtual void GetBatch(const ExpressEvent* events, size_t n_events, double* weights) const override
+    {
+        for(size_t n = 0; n < n_events; ++n)
+            weights[n] = TopPtWeight::Get(events[n]);
+    }
+
 private:
     double _p1, _p2;
 };
@@ -14,6 +14,29 @@ public:
     virtual ~IWeightProvider() {}
     virtual double Get(const ntuple::Event& event) const = 0;
     virtual double Get(const ntuple::ExpressEvent& event) const = 0;
+
+    // Names of the ntuple::Event branches read by Get. They are added to the branch manifests, because providers
+    // read ntuple::Event directly and their access is not seen by the branch usage recorder. By default, all
+    // branches are required.
+    virtual std::set<std::string> GetRequiredBranches() const
+    {
+        const auto& names = ntuple::EventBranchNames();
+        return std::set<std::string>(names.begin(), names.end());
+    }
+
+    // Weights for a contiguous block of events. By default, Get is called for each event. Providers override these
+    // methods to process the whole block without the virtual call per event.
+    virtual void GetBatch(const ntuple::Event* events, size_t n_events, double* weights) const
+    {
+        for(size_t n = 0; n < n_events; ++n)
+            weights[n] = Get(events[n]);
+    }
+
+    virtual void GetBatch(const ntuple::ExpressEvent* events, size_t n_events, double* weights) const
+    {
+        for(size_t n = 0; n < n_events; ++n)
+            weights[n] = Get(events[n]);
+    }
 };
 
 } // namespace mc_corrections
@@ -0,0 +1,98 @@
+/*! Process-wide registry of the weight providers shared between all users of the same correction data.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <typeinfo>
+#include "WeightProvider.h"
+
+namespace analysis {
+namespace mc_corrections {
+
+// Providers are identified by their type and the full list of constructor arguments (input files, histogram names,
+// working points, etc.). Each provider is constructed once, on the first request, and the same instance is returned
+// to all subsequent requests. The registry itself can be used from any thread, but the providers are not thread-safe:
+// e.g. LeptonWeights calls non-const methods of htt_utilities::ScaleFactor and BTagWeight evaluates TF1 formulas.
+// A shared provider should be used by one thread at a time.
+class WeightProviderRegistry {
+public:
+    using ProviderPtr = std::shared_ptr<IWeightProvider>;
+
+    static WeightProviderRegistry& Global()
+    {
+        static WeightProviderRegistry registry;
+        return registry;
+    }
+
+    template<typename Provider, typename... Args>
+    std::shared_ptr<Provider> Get(const Args&... args)
+    {
+        const std::string key = MakeKey(typeid(Provider).name(), args...);
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& entry_ref = entries[key];
+            if(!entry_ref)
+                entry_ref = std::make_shared<Entry>();
+            entry = entry_ref;
+        }
+        // Construction happens outside of the registry lock, so providers that are independent from each other can
+        // be loaded concurrently. If the constructor throws, the next request will try again.
+        std::call_once(entry->once_flag, [&]() { entry->provider = std::make_shared<Provider>(args...); });
+        return std::static_pointer_cast<Provider>(entry->provider);
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    // Releases references held by the registry. Providers that are already in use stay alive until their last user
+    // releases them.
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+
+private:
+    struct Entry {
+        std::once_flag once_flag;
+        ProviderPtr provider;
+    };
+
+    WeightProviderRegistry() {}
+    WeightProviderRegistry(const WeightProviderRegistry&) = delete;
+    WeightProviderRegistry& operator=(const WeightProviderRegistry&) = delete;
+
+    template<typename... Args>
+    static std::string MakeKey(const std::string& type_name, const Args&... args)
+    {
+        std::ostringstream ss;
+        ss.precision(17);
+        ss << type_name;
+        AddToKey(ss, args...);
+        return ss.str();
+    }
+
+    static void AddToKey(std::ostringstream& /*ss*/) {}
+
+    template<typename Arg, typename... Args>
+    static void AddToKey(std::ostringstream& ss, const Arg& arg, const Args&... args)
+    {
+        ss << '\n' << arg;
+        AddToKey(ss, args...);
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_ptr<Entry>> entries;
+};
+
+} // namespace mc_corrections
+} // namespace analysis
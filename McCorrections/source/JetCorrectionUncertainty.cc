@@ -29,6 +29,7 @@ JetCorrectionUncertainty::JetCorrectionUncertainty ()
   mIsLepPzset  = false;
   mAddLepToJet = false;
   mUncertainty = new SimpleJetCorrectionUncertainty();
+  initParametrization();
 }
 /////////////////////////////////////////////////////////////////////////
 JetCorrectionUncertainty::JetCorrectionUncertainty(const std::string& fDataFile)  
@@ -51,6 +52,7 @@ JetCorrectionUncertainty::JetCorrectionUncertainty(const std::string& fDataFile)
   mIsLepPzset  = false;
   mAddLepToJet = false;
   mUncertainty = new SimpleJetCorrectionUncertainty(fDataFile);
+  initParametrization();
 }
 /////////////////////////////////////////////////////////////////////////
 JetCorrectionUncertainty::JetCorrectionUncertainty(const JetCorrectorParameters& fParameters)  
@@ -73,6 +75,7 @@ JetCorrectionUncertainty::JetCorrectionUncertainty(const JetCorrectorParameters&
   mIsLepPzset  = false;
   mAddLepToJet = false;
   mUncertainty = new SimpleJetCorrectionUncertainty(fParameters);
+  initParametrization();
 }
 /////////////////////////////////////////////////////////////////////////
 JetCorrectionUncertainty::~JetCorrectionUncertainty () 
@@ -85,6 +88,7 @@ void JetCorrectionUncertainty::setParameters(const std::string& fDataFile)
   //---- delete the mParameters pointer before setting the new address ---
   delete mUncertainty; 
   mUncertainty = new SimpleJetCorrectionUncertainty(fDataFile);
+  initParametrization();
 }
 /////////////////////////////////////////////////////////////////////////
 float JetCorrectionUncertainty::getUncertainty(bool fDirection) 
@@ -104,6 +108,42 @@ float JetCorrectionUncertainty::getUncertainty(bool fDirection)
   mIsLepPzset  = false;
   return result;
 }
+/////////////////////////////////////////////////////////////////////////
+float JetCorrectionUncertainty::getUncertainty(float fEta, float fPt, bool fDirection) const
+{
+  if (mIsEtaPtParametrization)
+    return mUncertainty->uncertainty(fEta,fPt,fDirection);
+  const JetCorrectorParameters::Definitions& definitions = mUncertainty->parameters().definitions();
+  std::vector<float> vx = fillVector(definitions.binVar(),fEta,fPt);
+  std::vector<float> vy = fillVector(definitions.parVar(),fEta,fPt);
+  return mUncertainty->uncertainty(vx,vy[0],fDirection);
+}
+/////////////////////////////////////////////////////////////////////////
+void JetCorrectionUncertainty::initParametrization()
+{
+  const JetCorrectorParameters::Definitions& definitions = mUncertainty->parameters().definitions();
+  mIsEtaPtParametrization = definitions.nBinVar() == 1 && definitions.binVar(0) == "JetEta"
+                            && definitions.nParVar() == 1 && definitions.parVar(0) == "JetPt";
+}
+//------------------------------------------------------------------------ 
+//--- Fills a vector of floats for the stateless call --------------------
+//------------------------------------------------------------------------
+std::vector<float> JetCorrectionUncertainty::fillVector(const std::vector<std::string>& fNames, float fEta, float fPt)
+{
+  std::vector<float> result;
+  for(unsigned i=0;i<fNames.size();i++)
+    {
+      if (fNames[i] == "JetEta")
+        result.push_back(fEta);
+      else if (fNames[i] == "JetPt")
+        result.push_back(fPt);
+      else {
+	edm::LogError("JetCorrectionUncertainty::")<<" parameter "<<fNames[i]<<" is not supported by the stateless call";
+	result.push_back(-999.0);
+      }
+    }
+  return result;
+}
 //------------------------------------------------------------------------ 
 //--- Reads the parameter names and fills a vector of floats -------------
 //------------------------------------------------------------------------
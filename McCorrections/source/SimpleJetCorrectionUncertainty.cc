@@ -1,6 +1,7 @@
 #include "CondFormats/JetMETObjects/interface/SimpleJetCorrectionUncertainty.h"
 #include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include <algorithm>
 #include <vector>
 #include <string>
 
@@ -8,16 +9,19 @@
 SimpleJetCorrectionUncertainty::SimpleJetCorrectionUncertainty () 
 {
   mParameters = new JetCorrectorParameters();
+  initGrids();
 }
 /////////////////////////////////////////////////////////////////////////
 SimpleJetCorrectionUncertainty::SimpleJetCorrectionUncertainty(const std::string& fDataFile)  
 {
   mParameters = new JetCorrectorParameters(fDataFile);
+  initGrids();
 }
 /////////////////////////////////////////////////////////////////////////
 SimpleJetCorrectionUncertainty::SimpleJetCorrectionUncertainty(const JetCorrectorParameters& fParameters)  
 {
   mParameters = new JetCorrectorParameters(fParameters);
+  initGrids();
 }
 /////////////////////////////////////////////////////////////////////////
 SimpleJetCorrectionUncertainty::~SimpleJetCorrectionUncertainty () 
@@ -25,8 +29,51 @@ SimpleJetCorrectionUncertainty::~SimpleJetCorrectionUncertainty ()
   delete mParameters;
 }
 /////////////////////////////////////////////////////////////////////////
+//--- Splits the parameters of all records into contiguous (y, up, down) grids,
+//--- so they are not rebuilt for each call. Records can be found by the binary
+//--- search if they have a single bin variable, are sorted and don't overlap.
+void SimpleJetCorrectionUncertainty::initGrids()
+{
+  mGridOffsets.assign(1, 0);
+  mNParameters.clear();
+  mYGrid.clear();
+  mUpValues.clear();
+  mDownValues.clear();
+  mXMin.clear();
+  mXMax.clear();
+  mSortedGrids = true;
+  mUseBinarySearch = mParameters->definitions().nBinVar() == 1;
+  for(unsigned i=0;i<mParameters->size();i++)
+    {
+      const JetCorrectorParameters::Record& record = mParameters->record(i);
+      const std::vector<float> p = record.parameters();
+      mNParameters.push_back(p.size());
+      if ((p.size() % 3) == 0)
+        {
+          for(unsigned ind=0;ind<p.size();ind+=3)
+            {
+              if (ind > 0 && p[ind] < mYGrid.back())
+                mSortedGrids = false;
+              mYGrid.push_back(p[ind]);
+              mUpValues.push_back(p[ind+1]);
+              mDownValues.push_back(p[ind+2]);
+            }
+        }
+      mGridOffsets.push_back(mYGrid.size());
+      if (mUseBinarySearch)
+        {
+          if (i > 0 && (record.xMin(0) < mXMin.back() || record.xMin(0) < mXMax.back()))
+            mUseBinarySearch = false;
+          mXMin.push_back(record.xMin(0));
+          mXMax.push_back(record.xMax(0));
+        }
+    }
+}
+/////////////////////////////////////////////////////////////////////////
 float SimpleJetCorrectionUncertainty::uncertainty(const std::vector<float>& fX, float fY, bool fDirection) const 
 {
+  if (mUseBinarySearch && fX.size() == 1)
+    return uncertainty(fX[0], fY, fDirection);
   float result = 1.;
   int bin = mParameters->binIndex(fX);
   if (bin<0) {
@@ -37,34 +84,55 @@ float SimpleJetCorrectionUncertainty::uncertainty(const std::vector<float>& fX,
   return result;
 }
 /////////////////////////////////////////////////////////////////////////
+float SimpleJetCorrectionUncertainty::uncertainty(float fX, float fY, bool fDirection) const 
+{
+  if (!mUseBinarySearch)
+    return uncertainty(std::vector<float>(1, fX), fY, fDirection);
+  float result = 1.;
+  int bin = findRecord(fX);
+  if (bin<0) {
+    edm::LogError("SimpleJetCorrectionUncertainty")<<" bin variables out of range";
+    result = -999.0;
+  } else 
+    result = uncertaintyBin((unsigned)bin,fY,fDirection);
+  return result;
+}
+/////////////////////////////////////////////////////////////////////////
+//--- Same result as JetCorrectorParameters::binIndex for sorted --------
+//--- non-overlapping records: the only candidate is the last record ----
+//--- that starts before fX ---------------------------------------------
+int SimpleJetCorrectionUncertainty::findRecord(float fX) const
+{
+  int i = int(std::upper_bound(mXMin.begin(), mXMin.end(), fX) - mXMin.begin()) - 1;
+  if (i < 0 || !(fX < mXMax[i]))
+    return -1;
+  return i;
+}
+/////////////////////////////////////////////////////////////////////////
 float SimpleJetCorrectionUncertainty::uncertaintyBin(unsigned fBin, float fY, bool fDirection) const 
 {
   if (fBin >= mParameters->size()) { 
     edm::LogError("SimpleJetCorrectionUncertainty")<<" wrong bin: "<<fBin<<": only "<<mParameters->size()<<" are available";
     return -999.0;
   }
-  const std::vector<float>& p = mParameters->record(fBin).parameters();
-  if ((p.size() % 3) != 0)
-    throw cms::Exception ("SimpleJetCorrectionUncertainty")<<"wrong # of parameters: multiple of 3 expected, "<<p.size()<< " got";
-  std::vector<float> yGrid,value;
-  unsigned int N = p.size()/3;
+  if ((mNParameters[fBin] % 3) != 0)
+    throw cms::Exception ("SimpleJetCorrectionUncertainty")<<"wrong # of parameters: multiple of 3 expected, "<<mNParameters[fBin]<< " got";
+  const unsigned N = mGridOffsets[fBin+1] - mGridOffsets[fBin];
+  if (N == 0) {
+    edm::LogError("SimpleJetCorrectionUncertainty")<<" no parameters for bin: "<<fBin;
+    return -999.0;
+  }
+  const float* yGrid = &mYGrid[mGridOffsets[fBin]];
+  // true = UP, false = DOWN
+  const float* value = fDirection ? &mUpValues[mGridOffsets[fBin]] : &mDownValues[mGridOffsets[fBin]];
   float result = -1.0;
-  for(unsigned i=0;i<N;i++)
-    {
-      unsigned ind = 3*i;
-      yGrid.push_back(p[ind]);
-      if (fDirection)// true = UP
-        value.push_back(p[ind+1]);
-      else // false = DOWN
-        value.push_back(p[ind+2]); 
-    }
   if (fY <= yGrid[0])
     result = value[0];  
   else if (fY >= yGrid[N-1])
     result = value[N-1]; 
   else
     {
-      int bin = findBin(yGrid,fY); 
+      int bin = findBin(yGrid,N,fY); 
       float vx[2],vy[2];
       for(int i=0;i<2;i++)
         {
@@ -99,13 +167,15 @@ float SimpleJetCorrectionUncertainty::linearInterpolation(float fZ, const float
   return r;
 }
 /////////////////////////////////////////////////////////////////////////
-int SimpleJetCorrectionUncertainty::findBin(const std::vector<float>& v, float x) const
+int SimpleJetCorrectionUncertainty::findBin(const float* v, unsigned size, float x) const
 {
   int i;
-  int n = v.size()-1;
+  int n = int(size)-1;
   if (n<=0) return -1;
   if (x<v[0] || x>=v[n])
     return -1;
+  if (mSortedGrids)
+    return int(std::upper_bound(v, v+n, x) - v) - 1;
   for(i=0;i<n;i++)
    {
      if (x>=v[i] && x<v[i+1])
@@ -113,4 +183,3 @@ int SimpleJetCorrectionUncertainty::findBin(const std::vector<float>& v, float x
    }
   return 0; 
 }
-
@@ -0,0 +1,230 @@
+/*! Test of the binned lookup in the b tag calibration reader.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <random>
+#include <set>
+#include <boost/format.hpp>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/McCorrections/include/BTagCalibrationStandalone.h"
+
+struct Arguments {
+    run::Argument<std::string> sf_file{"sf_file", "b tag scale factors file"};
+    run::Argument<std::string> tagger{"tagger", "tagger name", "CSVv2"};
+    run::Argument<unsigned> n_points{"n_points", "number of random points per reader", 100000};
+    run::Argument<double> max_deviation{"max_deviation", "maximal allowed deviation from the reference", 1e-6};
+};
+
+namespace analysis {
+
+class BTagCalibration_t {
+public:
+    using BTagCalibration = btag_calibration::BTagCalibration;
+    using BTagCalibrationReader = btag_calibration::BTagCalibrationReader;
+    using BTagEntry = btag_calibration::BTagEntry;
+
+    struct Point {
+        float eta, pt, discr;
+    };
+
+    // Entries of one jet flavour and one systematic type, which are used to compute the reference results.
+    struct ReferenceEntries {
+        std::vector<BTagEntry> entries;
+        std::vector<TF1> functions;
+        bool use_discr, use_abs_eta;
+    };
+
+    BTagCalibration_t(const Arguments& _args) : args(_args), calib(args.tagger(), args.sf_file()) {}
+
+    void Run()
+    {
+        static const std::vector<BTagEntry::OperatingPoint> ops = {
+            BTagEntry::OP_LOOSE, BTagEntry::OP_MEDIUM, BTagEntry::OP_TIGHT, BTagEntry::OP_RESHAPING
+        };
+        static const std::vector<std::string> other_sys_types = { "up", "down" };
+
+        double max_deviation = 0;
+        for(auto op : ops) {
+            const std::string measurement = op == BTagEntry::OP_RESHAPING ? "iterativefit" : "comb";
+            const std::vector<std::string> reader_other_sys_types =
+                    op == BTagEntry::OP_RESHAPING ? std::vector<std::string>() : other_sys_types;
+            BTagCalibrationReader reader(op, "central", reader_other_sys_types);
+            reader.load(calib, BTagEntry::FLAV_B, measurement);
+            reader.load(calib, BTagEntry::FLAV_C, measurement);
+            reader.load(calib, BTagEntry::FLAV_UDSG, measurement == "comb" ? "incl" : measurement);
+            for(auto jf : { BTagEntry::FLAV_B, BTagEntry::FLAV_C, BTagEntry::FLAV_UDSG }) {
+                const std::string jf_measurement =
+                        jf == BTagEntry::FLAV_UDSG && measurement == "comb" ? "incl" : measurement;
+                const ReferenceEntries central = LoadReference(op, jf_measurement, "central", jf);
+                const std::vector<Point> points = MakePoints(central);
+                std::vector<ReferenceEntries> others;
+                for(const auto& sys : reader_other_sys_types)
+                    others.push_back(LoadReference(op, jf_measurement, sys, jf));
+
+                const auto report = [&](const std::string& name, double deviation) {
+                    std::cout << boost::format("op = %1%, flavour = %2%, %3%: max deviation = %4%.\n")
+                                 % op % jf % name % deviation;
+                    max_deviation = std::max(max_deviation, deviation);
+                };
+
+                double eval_deviation = 0, bounds_deviation = 0, central_auto_deviation = 0;
+                std::vector<double> other_auto_deviations(others.size(), 0.);
+                for(const Point& p : points) {
+                    const double ref = ReferenceEval(central, p.eta, p.pt, p.discr);
+                    eval_deviation = std::max(eval_deviation, std::abs(reader.eval(jf, p.eta, p.pt, p.discr) - ref));
+
+                    const auto ref_bounds = ReferenceMinMaxPt(central, p.eta, p.discr);
+                    const auto bounds = reader.min_max_pt(jf, p.eta, p.discr);
+                    bounds_deviation = std::max<double>(bounds_deviation,
+                            std::max(std::abs(bounds.first - ref_bounds.first),
+                                     std::abs(bounds.second - ref_bounds.second)));
+
+                    const double ref_auto = ReferenceEvalAutoBounds(central, nullptr, p);
+                    central_auto_deviation = std::max(central_auto_deviation,
+                            std::abs(reader.eval_auto_bounds("central", jf, p.eta, p.pt, p.discr) - ref_auto));
+                    for(size_t n = 0; n < others.size(); ++n) {
+                        const double ref_sys = ReferenceEvalAutoBounds(central, &others.at(n), p);
+                        const double value = reader.eval_auto_bounds(reader_other_sys_types.at(n), jf, p.eta, p.pt,
+                                                                     p.discr);
+                        other_auto_deviations.at(n) = std::max(other_auto_deviations.at(n),
+                                                               std::abs(value - ref_sys));
+                    }
+                }
+
+                report("eval", eval_deviation);
+                report("min_max_pt", bounds_deviation);
+                report("eval_auto_bounds(central)", central_auto_deviation);
+                for(size_t n = 0; n < others.size(); ++n)
+                    report("eval_auto_bounds(" + reader_other_sys_types.at(n) + ")", other_auto_deviations.at(n));
+            }
+        }
+        if(max_deviation > args.max_deviation())
+            throw exception("Maximal deviation %1% exceeds the allowed limit %2%.")
+                % max_deviation % args.max_deviation();
+    }
+
+private:
+    ReferenceEntries LoadReference(BTagEntry::OperatingPoint op, const std::string& measurement,
+                                   const std::string& sys, BTagEntry::JetFlavor jf) const
+    {
+        ReferenceEntries ref;
+        ref.use_discr = op == BTagEntry::OP_RESHAPING;
+        ref.use_abs_eta = true;
+        for(const auto& entry : calib.getEntries(BTagEntry::Parameters(op, measurement, sys))) {
+            if(entry.params.jetFlavor != jf) continue;
+            ref.entries.push_back(entry);
+            const float x_min = ref.use_discr ? entry.params.discrMin : entry.params.ptMin;
+            const float x_max = ref.use_discr ? entry.params.discrMax : entry.params.ptMax;
+            ref.functions.emplace_back("", entry.formula.c_str(), x_min, x_max);
+            if(entry.params.etaMin < 0)
+                ref.use_abs_eta = false;
+        }
+        return ref;
+    }
+
+    // Random points, and all combinations of the eta, pt and discr bin edges, where pt values below and above the
+    // bounds of the entries are added, so that eval_auto_bounds is tested both inside and outside of the bounds.
+    std::vector<Point> MakePoints(const ReferenceEntries& ref)
+    {
+        std::vector<Point> points;
+        std::uniform_real_distribution<float> eta_distr(-3.f, 3.f), pt_distr(0.f, 1200.f), discr_distr(-0.2f, 1.2f);
+        for(unsigned n = 0; n < args.n_points(); ++n) {
+            const float eta = eta_distr(generator), pt = pt_distr(generator);
+            const float discr = ref.use_discr ? discr_distr(generator) : 0.f;
+            points.push_back(Point{eta, pt, discr});
+        }
+
+        std::set<float> eta_edges, pt_edges = { 0.f, 5000.f }, discr_edges;
+        for(const auto& entry : ref.entries) {
+            const auto& p = entry.params;
+            for(float eta : { p.etaMin, p.etaMax }) {
+                eta_edges.insert(eta);
+                eta_edges.insert(-eta);
+            }
+            for(float pt : { p.ptMin, p.ptMax }) {
+                pt_edges.insert(pt);
+                pt_edges.insert(pt - 1.f);
+                pt_edges.insert(pt + 1.f);
+            }
+            discr_edges.insert(p.discrMin);
+            discr_edges.insert(p.discrMax);
+        }
+        if(!ref.use_discr)
+            discr_edges = { 0.f };
+        for(float eta : eta_edges) {
+            for(float pt : pt_edges) {
+                for(float discr : discr_edges)
+                    points.push_back(Point{eta, pt, discr});
+            }
+        }
+        return points;
+    }
+
+    // Linear search through the entries, as it is done by the reader without the binned lookup.
+    static double ReferenceEval(const ReferenceEntries& ref, float eta, float pt, float discr)
+    {
+        if(ref.use_abs_eta)
+            eta = std::abs(eta);
+        for(size_t n = 0; n < ref.entries.size(); ++n) {
+            const auto& p = ref.entries.at(n).params;
+            if(p.etaMin <= eta && eta < p.etaMax && p.ptMin < pt && pt <= p.ptMax) {
+                if(!ref.use_discr)
+                    return ref.functions.at(n).Eval(pt);
+                if(p.discrMin <= discr && discr < p.discrMax)
+                    return ref.functions.at(n).Eval(discr);
+            }
+        }
+        return 0.;
+    }
+
+    // Linear search through the entries, as it is done by the reader without the pre-computed pt bounds. The first
+    // entry in the eta range initializes the bounds without the discr check, as in the original implementation.
+    static std::pair<float, float> ReferenceMinMaxPt(const ReferenceEntries& ref, float eta, float discr)
+    {
+        if(ref.use_abs_eta)
+            eta = std::abs(eta);
+        float min_pt = -1., max_pt = -1.;
+        for(const auto& entry : ref.entries) {
+            const auto& p = entry.params;
+            if(!(p.etaMin <= eta && eta < p.etaMax)) continue;
+            if(min_pt < 0.) {
+                min_pt = p.ptMin;
+                max_pt = p.ptMax;
+                continue;
+            }
+            if(ref.use_discr && !(p.discrMin <= discr && discr < p.discrMax)) continue;
+            min_pt = std::min(min_pt, p.ptMin);
+            max_pt = std::max(max_pt, p.ptMax);
+        }
+        return std::make_pair(min_pt, max_pt);
+    }
+
+    static double ReferenceEvalAutoBounds(const ReferenceEntries& central, const ReferenceEntries* sys,
+                                          const Point& point)
+    {
+        const auto bounds = ReferenceMinMaxPt(central, point.eta, point.discr);
+        float pt = point.pt;
+        bool is_out_of_bounds = false;
+        if(pt < bounds.first) {
+            pt = bounds.first + .0001f;
+            is_out_of_bounds = true;
+        } else if(pt > bounds.second) {
+            pt = bounds.second - .0001f;
+            is_out_of_bounds = true;
+        }
+
+        const double sf = ReferenceEval(central, point.eta, pt, point.discr);
+        if(!sys)
+            return sf;
+        const double sf_err = ReferenceEval(*sys, point.eta, pt, point.discr);
+        return is_out_of_bounds ? sf + 2 * (sf_err - sf) : sf_err;
+    }
+
+private:
+    Arguments args;
+    BTagCalibration calib;
+    std::mt19937 generator;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::BTagCalibration_t, Arguments)
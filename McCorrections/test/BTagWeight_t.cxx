@@ -0,0 +1,87 @@
+/*! Test of the b tag weights computed for all uncertainty scales in one pass.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <random>
+#include <boost/format.hpp>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/McCorrections/include/BTagWeight.h"
+
+struct Arguments {
+    run::Argument<std::string> eff_file{"eff_file", "b tag efficiencies file"};
+    run::Argument<std::string> sf_file{"sf_file", "b tag scale factors file"};
+    run::Argument<unsigned> n_events{"n_events", "number of random events", 100000};
+    run::Argument<unsigned> max_jets{"max_jets", "maximal number of jets per event", 12};
+    run::Argument<double> max_deviation{"max_deviation", "maximal allowed relative deviation for the jet view",
+                                        1e-6};
+};
+
+namespace analysis {
+
+class BTagWeight_t {
+public:
+    using BTagWeight = mc_corrections::BTagWeight;
+
+    BTagWeight_t(const Arguments& _args) : args(_args),
+        bTagWeight(args.eff_file(), args.sf_file(), DiscriminatorWP::Medium) {}
+
+    void Run()
+    {
+        static const std::vector<int> flavours = { 0, 4, 5, -5, 21 };
+        static const std::vector<UncertaintyScale> scales = {
+            UncertaintyScale::Central, UncertaintyScale::Up, UncertaintyScale::Down
+        };
+
+        std::mt19937 generator;
+        std::uniform_int_distribution<unsigned> n_jets_distr(0, args.max_jets());
+        std::uniform_int_distribution<size_t> flavour_distr(0, flavours.size() - 1);
+        std::uniform_real_distribution<double> pt_distr(15., 1200.), eta_distr(-3., 3.), phi_distr(-3.14, 3.14),
+                                               m_distr(0., 30.), csv_distr(-0.1, 1.);
+
+        ntuple::Event event;
+        event.storageMode = 0;
+        event.storageMask.clear();
+        ntuple::TupleJetView jetView;
+        double max_deviation = 0;
+        for(unsigned n = 0; n < args.n_events(); ++n) {
+            const unsigned n_jets = n_jets_distr(generator);
+            event.jets_p4.clear();
+            event.jets_csv.clear();
+            event.jets_hadronFlavour.clear();
+            for(unsigned k = 0; k < n_jets; ++k) {
+                const LorentzVectorM p4(pt_distr(generator), eta_distr(generator), phi_distr(generator),
+                                        m_distr(generator));
+                event.jets_p4.push_back(ntuple::LorentzVectorE(p4));
+                event.jets_csv.push_back(static_cast<float>(csv_distr(generator)));
+                event.jets_hadronFlavour.push_back(flavours.at(flavour_distr(generator)));
+            }
+
+            const BTagWeight::ScaleWeights weights = bTagWeight.GetAllScales(event);
+            jetView.Reset(ntuple::EventAccessor(event));
+            const BTagWeight::ScaleWeights view_weights = bTagWeight.GetAllScales(jetView);
+            for(UncertaintyScale scale : scales) {
+                const size_t index = static_cast<size_t>(scale);
+                const double ref = bTagWeight.GetEx(event, scale);
+                if(weights[index] != ref)
+                    throw exception("GetAllScales differs from GetEx for event %1% with %2% jets, scale %3%:"
+                                    " %4% != %5%.") % n % n_jets % scale % weights[index] % ref;
+                const double deviation = ref != 0 ? std::abs(view_weights[index] / ref - 1)
+                                                  : std::abs(view_weights[index]);
+                max_deviation = std::max(max_deviation, deviation);
+            }
+        }
+
+        std::cout << boost::format("%1% events checked. Maximal relative deviation for the jet view = %2%.\n")
+                     % args.n_events() % max_deviation;
+        if(max_deviation > args.max_deviation())
+            throw exception("Maximal deviation for the jet view %1% is above the limit %2%.")
+                % max_deviation % args.max_deviation();
+    }
+
+private:
+    Arguments args;
+    BTagWeight bTagWeight;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::BTagWeight_t, Arguments)
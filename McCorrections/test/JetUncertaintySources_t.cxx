@@ -0,0 +1,139 @@
+/*! Test of the JES uncertainty evaluation with the binary search in SimpleJetCorrectionUncertainty and of the
+evaluation of all sources at once in JetUncertaintySources.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <boost/format.hpp>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "CondFormats/JetMETObjects/interface/JetCorrectionUncertainty.h"
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "h-tautau/McCorrections/include/JetUncertaintySources.h"
+
+struct Arguments {
+    run::Argument<std::string> input_file{"input_file", "JES uncertainty sources file"};
+    run::Argument<unsigned> n_points{"n_points", "number of random (eta, pt) points", 200000};
+    run::Argument<bool> use_binary_cache{"use_binary_cache", "use binary cache in JetUncertaintySources", false};
+};
+
+namespace analysis {
+
+class JetUncertaintySources_t {
+public:
+    using JetUncertaintySources = mc_corrections::JetUncertaintySources;
+    using ParametersPtr = std::shared_ptr<JetCorrectorParameters>;
+    using UncertaintyPtr = std::shared_ptr<JetCorrectionUncertainty>;
+    using Point = std::pair<float, float>;
+
+    JetUncertaintySources_t(const Arguments& _args) :
+        args(_args), sources(args.input_file(), {}, args.use_binary_cache())
+    {
+        for(const std::string& name : sources.GetSourceNames()) {
+            parameters.push_back(std::make_shared<JetCorrectorParameters>(args.input_file(), name));
+            uncertainties.push_back(std::make_shared<JetCorrectionUncertainty>(*parameters.back()));
+        }
+    }
+
+    void Run()
+    {
+        const std::vector<Point> points = CreatePoints();
+        const size_t n_sources = sources.GetNumberOfSources();
+        std::vector<float> up(n_sources), down(n_sources);
+        size_t n_different = 0;
+        for(const Point& point : points) {
+            const float eta = point.first, pt = point.second;
+            sources.Evaluate(eta, pt, up.data(), down.data());
+            for(size_t n = 0; n < n_sources; ++n) {
+                JetCorrectionUncertainty& unc = *uncertainties.at(n);
+                for(bool direction : { true, false }) {
+                    const float ref = ReferenceUncertainty(*parameters.at(n), eta, pt, direction);
+                    unc.setJetEta(eta);
+                    unc.setJetPt(pt);
+                    const float values[] = {
+                        unc.getUncertainty(direction), unc.getUncertainty(eta, pt, direction),
+                        direction ? up.at(n) : down.at(n)
+                    };
+                    static const std::vector<std::string> methods = {
+                        "JetCorrectionUncertainty", "stateless JetCorrectionUncertainty", "JetUncertaintySources"
+                    };
+                    for(size_t k = 0; k < methods.size(); ++k) {
+                        if(IsSame(values[k], ref)) continue;
+                        if(n_different++ < 10)
+                            std::cout << boost::format("%1% differs from the reference for source '%2%', eta = %3%,"
+                                                       " pt = %4%, %5%: %6% != %7%.\n") % methods.at(k)
+                                         % sources.GetSourceNames().at(n) % eta % pt % (direction ? "up" : "down")
+                                         % values[k] % ref;
+                    }
+                }
+            }
+        }
+
+        if(n_different)
+            throw exception("%1% differences found.") % n_different;
+        std::cout << boost::format("%1% points checked for %2% sources.\n") % points.size() % n_sources;
+    }
+
+private:
+    // Random points and all bin boundaries and grid nodes of the first source, where the search is most sensitive.
+    std::vector<Point> CreatePoints() const
+    {
+        std::vector<Point> points;
+        std::mt19937 generator;
+        std::uniform_real_distribution<float> eta_distr(-6.f, 6.f), pt_distr(0.f, 7000.f);
+        for(unsigned n = 0; n < args.n_points(); ++n)
+            points.emplace_back(eta_distr(generator), pt_distr(generator));
+
+        const JetCorrectorParameters& params = *parameters.front();
+        for(unsigned bin = 0; bin < params.size(); ++bin) {
+            const JetCorrectorParameters::Record& record = params.record(bin);
+            const float eta_middle = record.xMiddle(0);
+            for(float eta : { record.xMin(0), record.xMax(0), eta_middle }) {
+                for(unsigned k = 0; k + 2 < record.nParameters(); k += 3)
+                    points.emplace_back(eta, record.parameter(k));
+            }
+        }
+        return points;
+    }
+
+    // Reference implementation with the linear search of the bin and of the grid interval, as in
+    // SimpleJetCorrectionUncertainty before the grids were pre-split.
+    static float ReferenceUncertainty(const JetCorrectorParameters& params, float eta, float pt, bool direction)
+    {
+        const int bin = params.binIndex(std::vector<float>(1, eta));
+        if(bin < 0) return -999.f;
+        const std::vector<float> p = params.record(static_cast<unsigned>(bin)).parameters();
+        const unsigned N = static_cast<unsigned>(p.size() / 3);
+        if(N == 0) return -999.f;
+        std::vector<float> y(N), value(N);
+        for(unsigned i = 0; i < N; ++i) {
+            y[i] = p[3 * i];
+            value[i] = direction ? p[3 * i + 1] : p[3 * i + 2];
+        }
+        if(pt <= y[0]) return value[0];
+        if(pt >= y[N - 1]) return value[N - 1];
+        unsigned i = 0;
+        for(; i + 1 < N; ++i) {
+            if(pt >= y[i] && pt < y[i + 1]) break;
+        }
+        if(i + 1 >= N)
+            i = 0;
+        if(y[i] == y[i + 1])
+            return value[i] == value[i + 1] ? value[i] : -999.f;
+        const float a = (value[i + 1] - value[i]) / (y[i + 1] - y[i]);
+        const float b = (value[i] * y[i + 1] - value[i + 1] * y[i]) / (y[i + 1] - y[i]);
+        return a * pt + b;
+    }
+
+    static bool IsSame(float a, float b) { return a == b || (std::isnan(a) && std::isnan(b)); }
+
+private:
+    Arguments args;
+    JetUncertaintySources sources;
+    std::vector<ParametersPtr> parameters;
+    std::vector<UncertaintyPtr> uncertainties;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::JetUncertaintySources_t, Arguments)
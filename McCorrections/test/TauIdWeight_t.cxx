@@ -23,7 +23,8 @@ public:
     using TauIdWeight = analysis::mc_corrections::TauIdWeight;
 
     TauIdWeight_t(const Arguments& _args) : args(_args),
-        tauId_weight(args.json_file(), Parse<DiscriminatorWP>(args.iso_type()))
+        tauId_weight(args.json_file(), Parse<DiscriminatorWP>(args.iso_type())),
+        tauId_weight_tables(args.json_file(), Parse<DiscriminatorWP>(args.iso_type()), true)
     {
 
     }
@@ -35,16 +36,25 @@ public:
         auto inputFile = root_ext::OpenRootFile(args.input_file());
         auto eventTuple = ntuple::CreateEventTuple("tauTau",inputFile.get(),true,ntuple::TreeState::Full);
 
+        double max_abs_diff = 0, max_rel_diff = 0;
         for(const ntuple::Event& event : *eventTuple) {
-            std::cout << "TauID weight: " << tauId_weight.Get(event) << std::endl;
+            const double weight = tauId_weight.Get(event);
+            const double weight_tables = tauId_weight_tables.Get(event);
+            std::cout << "TauID weight: " << weight << ", from SF tables: " << weight_tables << std::endl;
+            const double abs_diff = std::abs(weight_tables - weight);
+            max_abs_diff = std::max(max_abs_diff, abs_diff);
+            if(weight != 0)
+                max_rel_diff = std::max(max_rel_diff, abs_diff / std::abs(weight));
         }
+        std::cout << boost::format("Accuracy of the SF tables: max absolute difference = %1%,"
+                                   " max relative difference = %2%.") % max_abs_diff % max_rel_diff << std::endl;
 
     }
 
 
 private:
     Arguments args;
-    TauIdWeight tauId_weight;
+    TauIdWeight tauId_weight, tauId_weight_tables;
 
 };
 
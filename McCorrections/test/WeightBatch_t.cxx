@@ -0,0 +1,76 @@
+/*! Benchmark of the batch evaluation of the event weights.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#include <chrono>
+#include <random>
+#include <boost/format.hpp>
+#include "AnalysisTools/Run/include/program_main.h"
+#include "h-tautau/McCorrections/include/PileUpWeight.h"
+#include "h-tautau/McCorrections/include/TopPtWeight.h"
+
+struct Arguments {
+    run::Argument<std::string> pu_file{"pu_file", "pile up weights file"};
+    run::Argument<std::string> pu_hist_name{"pu_hist_name", "pile up weights histogram name"};
+    run::Argument<unsigned> n_events{"n_events", "number of events in the block", 1000000};
+    run::Argument<unsigned> n_iterations{"n_iterations", "number of passes over the block", 10};
+};
+
+namespace analysis {
+
+class WeightBatch_t {
+public:
+    using ProviderPtr = std::shared_ptr<mc_corrections::IWeightProvider>;
+    using Clock = std::chrono::high_resolution_clock;
+
+    WeightBatch_t(const Arguments& _args) : args(_args) {}
+
+    void Run()
+    {
+        std::vector<ntuple::ExpressEvent> events(args.n_events());
+        std::mt19937 generator;
+        std::uniform_real_distribution<float> npu_distr(0.f, 70.f), top_pt_distr(0.f, 600.f);
+        for(auto& event : events) {
+            event.npu = npu_distr(generator);
+            event.gen_top_pt = top_pt_distr(generator);
+            event.gen_topBar_pt = top_pt_distr(generator);
+        }
+
+        const std::map<std::string, ProviderPtr> providers = {
+            { "PileUp", std::make_shared<mc_corrections::PileUpWeight>(args.pu_file(), args.pu_hist_name(), 60, 0) },
+            { "TopPt", std::make_shared<mc_corrections::TopPtWeight>(0.0615, 0.0005) },
+        };
+
+        std::vector<double> event_weights(events.size()), batch_weights(events.size());
+        for(const auto& provider : providers) {
+            const double event_rate = Measure(events.size(), [&]() {
+                for(size_t n = 0; n < events.size(); ++n)
+                    event_weights[n] = provider.second->Get(events[n]);
+            });
+            const double batch_rate = Measure(events.size(), [&]() {
+                provider.second->GetBatch(events.data(), events.size(), batch_weights.data());
+            });
+            if(event_weights != batch_weights)
+                throw exception("%1% weights computed per event and in batch differ.") % provider.first;
+            std::cout << boost::format("%1%: per event %2% events/s, batch %3% events/s, speed-up %4%.\n")
+                         % provider.first % event_rate % batch_rate % (batch_rate / event_rate);
+        }
+    }
+
+private:
+    template<typename Function>
+    double Measure(size_t n_events, Function&& process) const
+    {
+        const auto start = Clock::now();
+        for(unsigned n = 0; n < args.n_iterations(); ++n)
+            process();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        return n_events * args.n_iterations() / elapsed.count();
+    }
+
+private:
+    Arguments args;
+};
+
+} // namespace analysis
+
+PROGRAM_MAIN(analysis::WeightBatch_t, Arguments)
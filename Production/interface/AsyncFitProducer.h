@@ -0,0 +1,128 @@
+/*! Pool of worker threads that run SVfit and HHKinFit2 asynchronously with respect to the event processing.
+This file is part of https://github.com/hh-italian-group/h-tautau. */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "h-tautau/Analysis/include/KinFitInterface.h"
+#include "SVfitInterface.h"
+
+namespace analysis {
+
+// Fits are executed in the order in which they are scheduled. Fit producers are not safe to be shared between
+// threads, so each worker owns its own instances. The pool can be shared between several producers. The number of
+// scheduled fits that wait for a free worker is limited: when the limit is reached, scheduling blocks until a worker
+// takes the next task.
+class AsyncFitProducer {
+public:
+    using SVfitResults = sv_fit::FitResults;
+    using KinFitResults = kin_fit::FitResults;
+
+    AsyncFitProducer(size_t n_threads, const std::string& svfitResolutionFileName,
+                     size_t max_queued_tasks_per_thread = 10) :
+        max_queued_tasks(std::max<size_t>(max_queued_tasks_per_thread, 1) * n_threads), stop(false)
+    {
+        if(!n_threads)
+            throw exception("Number of fit threads should be positive.");
+        for(size_t n = 0; n < n_threads; ++n) {
+            auto worker = std::make_shared<Worker>();
+            if(!svfitResolutionFileName.empty())
+                worker->svfitProducer = std::make_shared<sv_fit::FitProducer>(svfitResolutionFileName);
+            workers.push_back(worker);
+        }
+        for(size_t n = 0; n < n_threads; ++n)
+            threads.emplace_back(&AsyncFitProducer::ProcessTasks, this, n);
+    }
+
+    AsyncFitProducer(const AsyncFitProducer&) = delete;
+    AsyncFitProducer& operator=(const AsyncFitProducer&) = delete;
+
+    ~AsyncFitProducer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    size_t NumberOfThreads() const { return threads.size(); }
+
+    std::shared_future<SVfitResults> RunSVfit(const std::vector<svFitStandalone::MeasuredTauLepton>& measured_leptons,
+                                              const LorentzVector& met_momentum, const SquareMatrix<2>& met_cov)
+    {
+        return Schedule<SVfitResults>([=](Worker& worker) {
+            if(!worker.svfitProducer)
+                throw exception("SVfit is not configured for the asynchronous fit producer.");
+            return worker.svfitProducer->Fit(measured_leptons, met_momentum, met_cov);
+        });
+    }
+
+    template<typename Met>
+    std::shared_future<KinFitResults> RunKinFit(const LorentzVector& lepton1_p4, const LorentzVector& lepton2_p4,
+                                                const LorentzVector& jet1_p4, const LorentzVector& jet2_p4,
+                                                const Met& met)
+    {
+        return Schedule<KinFitResults>([=](Worker& worker) {
+            return worker.kinfitProducer.Fit(lepton1_p4, lepton2_p4, jet1_p4, jet2_p4, met);
+        });
+    }
+
+private:
+    struct Worker {
+        std::shared_ptr<sv_fit::FitProducer> svfitProducer;
+        kin_fit::FitProducer kinfitProducer;
+    };
+
+    using Task = std::function<void(Worker&)>;
+
+    template<typename Result, typename Function>
+    std::shared_future<Result> Schedule(Function&& function)
+    {
+        auto task = std::make_shared<std::packaged_task<Result(Worker&)>>(std::forward<Function>(function));
+        std::shared_future<Result> result = task->get_future().share();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queue_condition.wait(lock, [&]() { return tasks.size() < max_queued_tasks; });
+            tasks.emplace_back([task](Worker& worker) { (*task)(worker); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+    void ProcessTasks(size_t worker_id)
+    {
+        Worker& worker = *workers.at(worker_id);
+        while(true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() { return stop || !tasks.empty(); });
+                if(tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            queue_condition.notify_one();
+            task(worker);
+        }
+    }
+
+private:
+    std::vector<std::shared_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::deque<Task> tasks;
+    const size_t max_queued_tasks;
+    std::mutex mutex;
+    std::condition_variable condition, queue_condition;
+    bool stop;
+};
+
+} // namespace analysis
@@ -3,8 +3,11 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <array>
 #include <iomanip>
 #include <functional>
+#include <mutex>
+#include <set>
 #include <string>
 #include <iostream>
 
@@ -12,7 +15,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 //For CMSSW
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/EDAnalyzer.h"
+#include "FWCore/Framework/interface/stream/EDAnalyzer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EventSetup.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
@@ -61,11 +64,13 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 //SVFit
 #include "FWCore/ParameterSet/interface/FileInPath.h"
 #include "SelectionResults.h"
+#include "AsyncFitProducer.h"
 
 //Recoil Correction
 #include "HTT-utilities/RecoilCorrections/interface/RecoilCorrector.h"
 
 #include "TriggerTools.h"
+#include "GenTruthTools.h"
 
 struct TupleProducerData : public root_ext::AnalyzerData {
     explicit TupleProducerData(TDirectory* _directory, const std::string& subDirectoryName = "") :
@@ -77,6 +82,12 @@ struct TupleProducerData : public root_ext::AnalyzerData {
     TH1D_ENTRY_FIX(N_objects, 1, 500, -0.5)
     TH1D_ENTRY(Mass, 3000, 0.0, 3000.0)
     TH1D_ENTRY(Htautau_Mass, 60, 0.0, 300.0)
+    // log10 of the time in microseconds spent to set the trigger accept bits (from 10 ns to 1 s): 'menu_scan' for
+    // events where HLT paths are matched with the trigger patterns, 'cached' for events that reuse the matching done
+    // for the same trigger menu.
+    TH1D_ENTRY(TriggerAcceptBits_log10_time, 160, -2.0, 6.0)
+    // SVfit cache lookups for each energy scale: 0 - miss, 1 - hit.
+    TH1D_ENTRY_FIX(SVfit_cache, 1, 2, -0.5)
 };
 
 struct SelectionData : public root_ext::AnalyzerData {
@@ -106,7 +117,99 @@ ENUM_NAMES(ProductionMode) = {
     { ProductionMode::h_tt_sm, "h_tt_sm" },
 };
 
-class BaseTupleProducer : public edm::EDAnalyzer {
+// Data shared between the stream instances of a tuple producer. The output tuple is filled by one stream at a time,
+// and all entries of an event are filled together, since the entries for the shifted energy scales refer to the
+// central one. The same lock protects the creation of directories and histograms in the output file.
+// Streams pass their entries as soon as all fits for an event are done, so with more than one stream the order of
+// the events in the output tuple is not reproducible between jobs. Only the entries of the same event are guaranteed
+// to be consecutive, with the fully stored entry first.
+// If numberOfFitThreads > 0, SVfit and HHKinFit2 for all streams run on a single pool of fit threads owned by the
+// cache, so that the total number of fit threads and of queued fits does not grow with the number of streams.
+class TupleProducerGlobalCache {
+public:
+    explicit TupleProducerGlobalCache(const edm::ParameterSet& iConfig) : n_instances(0)
+    {
+        const unsigned numberOfFitThreads = iConfig.getUntrackedParameter<unsigned>("numberOfFitThreads", 0);
+        const bool runSVfit = iConfig.getParameter<bool>("runSVfit");
+        const bool runKinFit = iConfig.getParameter<bool>("runKinFit");
+        if(numberOfFitThreads > 0 && (runSVfit || runKinFit))
+            asyncFitProducer = std::make_shared<analysis::AsyncFitProducer>(numberOfFitThreads,
+                    runSVfit ? GetSVfitResolutionFileName() : "");
+    }
+
+    static std::string GetSVfitResolutionFileName()
+    {
+        return edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitVisMassAndPtResolutionPDF.root").fullPath();
+    }
+
+    std::shared_ptr<analysis::AsyncFitProducer> GetAsyncFitProducer() const { return asyncFitProducer; }
+
+    size_t RegisterInstance(const std::string& treeName) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!eventTuple) {
+            TFile* file = &edm::Service<TFileService>()->file();
+            eventTuple = std::make_shared<ntuple::EventTuple>(treeName, file, false);
+            ntuple::SetStorageSettings(treeName, file, ntuple::VectorBranchStorageSettings());
+        }
+        return n_instances++;
+    }
+
+    // Entries for the shifted energy scales store only the branches that differ from the last fully stored entry of
+    // the same event. The remaining branches are restored by ntuple::EventLoader::Load.
+    template<typename Iterator>
+    void Fill(Iterator first, Iterator last) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const ntuple::Event* reference = nullptr;
+        for(; first != last; ++first) {
+            const ntuple::Event& event = *first;
+            (*eventTuple)() = event;
+            if(reference && event.run == reference->run && event.lumi == reference->lumi
+                    && event.evt == reference->evt)
+                ntuple::EventLoader::Compress((*eventTuple)(), *reference);
+            if(ntuple::EventLoader::IsFullyStored((*eventTuple)()))
+                reference = &event;
+            eventTuple->Fill();
+        }
+    }
+
+    void Write() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(eventTuple)
+            eventTuple->Write();
+    }
+
+    std::mutex& GetFileMutex() const { return mutex; }
+
+private:
+    mutable std::mutex mutex;
+    mutable size_t n_instances;
+    mutable std::shared_ptr<ntuple::EventTuple> eventTuple;
+    std::shared_ptr<analysis::AsyncFitProducer> asyncFitProducer;
+};
+
+// Entries filled by a stream instance that are not yet passed to the shared output tuple.
+class EventTupleBuffer {
+public:
+    ntuple::Event& operator()() { return event; }
+
+    void Fill()
+    {
+        events.push_back(event);
+        event = ntuple::Event();
+    }
+
+    const std::vector<ntuple::Event>& GetEvents() const { return events; }
+    void Erase(size_t n_events) { events.erase(events.begin(), events.begin() + n_events); }
+
+private:
+    ntuple::Event event;
+    std::vector<ntuple::Event> events;
+};
+
+class BaseTupleProducer : public edm::stream::EDAnalyzer<edm::GlobalCache<TupleProducerGlobalCache>> {
 public:
     using ElectronCandidate = analysis::LeptonCandidate<pat::Electron, edm::Ptr<pat::Electron>>;
     using MuonCandidate = analysis::LeptonCandidate<pat::Muon>;
@@ -119,9 +222,33 @@ public:
     using LorentzVector = analysis::LorentzVector;
     using LorentzVectorM = analysis::LorentzVectorM;
     using LorentzVectorE = analysis::LorentzVectorE;
+    using SelectionDependencies = std::vector<const void*>;
+    using SignalLeptonMomentums = std::array<LorentzVector, 2>;
+
+private:
+    struct SelectionCacheEntry {
+        const void* candidates;
+        SelectionDependencies dependencies;
+        std::vector<size_t> selected;
+    };
+
+    // Fits scheduled for the tuple entry that is being filled.
+    struct PendingFits {
+        std::shared_future<analysis::sv_fit::FitResults> svfitResult;
+        std::map<size_t, std::shared_future<analysis::kin_fit::FitResults>> kinfitResults;
+
+        bool IsReady() const;
+    };
+
+    // Tuple entry that waits for the results of the asynchronous fits before being written.
+    struct PendingEntry {
+        ntuple::Event event;
+        PendingFits fits;
+    };
 
 private:
     std::string treeName;
+    std::string instanceSuffix;
     TupleProducerData anaData;
     std::map<std::string, std::shared_ptr<SelectionData>> anaDataBeforeCut, anaDataAfterCut;
     edm::EDGetToken electronsMiniAOD_token;
@@ -145,11 +272,13 @@ protected:
     const bool isMC, applyTriggerMatch, runSVfit, runKinFit, applyRecoilCorr;
     const int nJetsRecoilCorr;    
     const bool saveGenTopInfo, saveGenBosonInfo, saveGenJetInfo;
+    const bool incrementalSelection;
     analysis::TriggerDescriptors triggerDescriptors;
-    ntuple::EventTuple eventTuple;
+    EventTupleBuffer eventTuple;
     analysis::TriggerTools triggerTools;
     std::shared_ptr<analysis::sv_fit::FitProducer> svfitProducer;
     std::shared_ptr<analysis::kin_fit::FitProducer> kinfitProducer;
+    std::shared_ptr<analysis::AsyncFitProducer> asyncFitProducer;
     std::shared_ptr<RecoilCorrector> recoilPFMetCorrector;
 
 private:
@@ -172,6 +301,18 @@ private:
 
     std::vector<analysis::EventEnergyScale> eventEnergyScales;
 
+    // State shared between the passes over the same event with different energy scales.
+    bool candidateCollectionsInitialized;
+    int tauShift, jetShift;
+    std::vector<double> jetUncertainties;
+    std::map<const reco::Candidate*, analysis::gen_truth::MatchResult> genMatches;
+    std::map<std::string, SelectionCacheEntry> selectionCache;
+    analysis::sv_fit::FitResultsCache svfitCache;
+    analysis::sv_fit::BasicFitResultsCache<std::shared_future<analysis::sv_fit::FitResults>> asyncSvfitCache;
+    PendingFits currentFits;
+    std::deque<PendingEntry> pendingEntries;
+    std::set<std::pair<const void*, std::string>> createdAnaDataEntries;
+
 protected:
     edm::EventID eventId;
     analysis::EventEnergyScale eventEnergyScale;
@@ -189,32 +330,60 @@ private:
     void InitializeAODCollections(const edm::Event& iEvent, const edm::EventSetup& iSetup);
     void InitializeCandidateCollections(analysis::EventEnergyScale eventEnergyScale);
     virtual void analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup) override;
-    virtual void endJob() override;
+    virtual void endStream() override;
     virtual void ProcessEvent(Cutter& cut) = 0;
     static double Isolation(const pat::Electron& electron);
     static double Isolation(const pat::Muon& muon);
     static double Isolation(const pat::Tau& tau);
+    void InvalidateSelectionCache(const void* candidates);
+    void WritePendingEntries(bool wait_for_all);
+    void FlushEventTuple();
 
 public:
-    BaseTupleProducer(const edm::ParameterSet& iConfig, const std::string& treeName);
+    BaseTupleProducer(const edm::ParameterSet& iConfig, const std::string& treeName,
+                      const TupleProducerGlobalCache* cache);
+
+    static std::unique_ptr<TupleProducerGlobalCache> initializeGlobalCache(const edm::ParameterSet& iConfig)
+    {
+        return std::unique_ptr<TupleProducerGlobalCache>(new TupleProducerGlobalCache(iConfig));
+    }
+
+    static void globalEndJob(const TupleProducerGlobalCache* cache) { cache->Write(); }
 
 protected:
     TupleProducerData& GetAnaData() { return anaData; }
 
+    // Histograms of anaData are created in the shared output file on the first access, so the first access to each
+    // of them is done under the file lock.
+    template<typename Entry>
+    auto GetAnaData(Entry& entry, const std::string& name) -> decltype(entry(name))
+    {
+        const auto key = std::make_pair(static_cast<const void*>(&entry), name);
+        if(!createdAnaDataEntries.count(key)) {
+            std::lock_guard<std::mutex> lock(globalCache()->GetFileMutex());
+            entry(name);
+            createdAnaDataEntries.insert(key);
+        }
+        return entry(name);
+    }
+
     static bool PassPFLooseId(const pat::Jet& pat_jet);
     static bool PassICHEPMuonMediumId(const pat::Muon& pat_muon);
 
+    void SetTriggerAcceptBits(analysis::TriggerResults& results);
     void ApplyBaseSelection(analysis::SelectionResultsBase& selection,
-                            const std::vector<LorentzVector>& signalLeptonMomentums);
+                            const SignalLeptonMomentums& signalLeptonMomentums);
     void FillEventTuple(const analysis::SelectionResultsBase& selection,
                         const analysis::SelectionResultsBase* reference = nullptr);
+    void WriteEventTuple();
     void FillElectronLeg(size_t leg_id, const ElectronCandidate& electron);
     void FillMuonLeg(size_t leg_id, const MuonCandidate& muon);
     void FillTauLeg(size_t leg_id, const TauCandidate& tau, bool fill_tauIds);
     void FillLheInfo(bool haveReference);
     void FillGenParticleInfo();
     void FillGenJetInfo();
-    void FillLegGenMatch(size_t leg_id, const analysis::LorentzVectorXYZ& p4);
+    void FillLegGenMatch(size_t leg_id, const reco::Candidate& object);
+    const analysis::gen_truth::MatchResult& GetGenMatch(const reco::Candidate& object);
     void FillTauIds(size_t leg_id, const std::vector<pat::Tau::IdPair>& tauIds);
     void FillMetFilters();
     void ApplyRecoilCorrection(const std::vector<JetCandidate>& jets);
@@ -222,14 +391,14 @@ protected:
     std::vector<ElectronCandidate> CollectVetoElectrons(
             const std::vector<const ElectronCandidate*>& signalElectrons = {});
     std::vector<MuonCandidate> CollectVetoMuons(const std::vector<const MuonCandidate*>& signalMuons = {});
-    std::vector<JetCandidate> CollectJets(const std::vector<LorentzVector>& signalLeptonMomentums);
+    std::vector<JetCandidate> CollectJets(const SignalLeptonMomentums& signalLeptonMomentums);
 
     void SelectVetoElectron(const ElectronCandidate& electron, Cutter& cut,
                             const std::vector<const ElectronCandidate*>& signalElectrons) const;
     void SelectVetoMuon(const MuonCandidate& muon, Cutter& cut,
                         const std::vector<const MuonCandidate*>& signalMuons) const;
     void SelectJet(const JetCandidate& jet, Cutter& cut,
-                   const std::vector<LorentzVector>& signalLeptonMomentums) const;
+                   const SignalLeptonMomentums& signalLeptonMomentums) const;
 
     template<typename Candidate1, typename Candidate2,
              typename ResultCandidate = analysis::CompositCandidate<Candidate1, Candidate2>>
@@ -247,12 +416,12 @@ protected:
                     if (expectedCharge !=analysis::AnalysisObject::UnknownCharge
                             && candidate.GetCharge() != expectedCharge) continue;
                     result.push_back(candidate);
-                    GetAnaData().Mass(hist_name).Fill(candidate.GetMomentum().M(), 1);
+                    GetAnaData(GetAnaData().Mass, hist_name).Fill(candidate.GetMomentum().M(), 1);
                 }
             }
         }
 
-        GetAnaData().N_objects(hist_name).Fill(result.size(), 1);
+        GetAnaData(GetAnaData().N_objects, hist_name).Fill(result.size(), 1);
         return result;
     }
 
@@ -265,10 +434,12 @@ protected:
         std::ostringstream ss_suffix;
         ss_suffix << selection_label << "_" << eventEnergyScale;
         const std::string suffix = ss_suffix.str();
-        cuts::ObjectSelector& objectSelector = GetAnaData().Selection(suffix);
-        if(!anaDataBeforeCut.count(suffix))
+        cuts::ObjectSelector& objectSelector = GetAnaData(GetAnaData().Selection, suffix);
+        if(!anaDataBeforeCut.count(suffix)) {
+            std::lock_guard<std::mutex> lock(globalCache()->GetFileMutex());
             anaDataBeforeCut[suffix] = std::make_shared<SelectionData>(&edm::Service<TFileService>()->file(),
-                                                                       treeName + "_before_cut/" + suffix);
+                    treeName + "_before_cut" + instanceSuffix + "/" + suffix);
+        }
 
         SelectionManager selectionManager(anaDataBeforeCut.at(suffix)->h, weight);
 
@@ -282,21 +453,83 @@ protected:
 
         const auto selected = objectSelector.collect_objects<Candidate>(1, all_candidates.size(), selector, comparitor);
 
-        if(!anaDataAfterCut.count(suffix))
+        if(!anaDataAfterCut.count(suffix)) {
+            std::lock_guard<std::mutex> lock(globalCache()->GetFileMutex());
             anaDataAfterCut[suffix] = std::make_shared<SelectionData>(&edm::Service<TFileService>()->file(),
-                                                                       treeName + "_after_cut/" + suffix);
+                    treeName + "_after_cut" + instanceSuffix + "/" + suffix);
+        }
 
         SelectionManager selectionManager_afterCut(anaDataAfterCut.at(suffix)->h, weight);
         for(const auto& candidate : selected) {
             Cutter cut(nullptr, &selectionManager_afterCut);
             base_selector(candidate, cut);
         }
-        GetAnaData().N_objects(suffix).Fill(selected.size(), 1);
-        GetAnaData().N_objects(suffix + "_original").Fill(all_candidates.size(), weight);
+        GetAnaData(GetAnaData().N_objects, suffix).Fill(selected.size(), 1);
+        GetAnaData(GetAnaData().N_objects, suffix + "_original").Fill(all_candidates.size(), weight);
+
+        return selected;
+    }
+
+    // Same as CollectObjects, but in the incremental selection mode the result is reused by the passes over the same
+    // event with other energy scales, as long as the candidate collection has not been rebuilt and the selection
+    // dependencies are the same. The selection histograms are filled only when the selection is actually performed.
+    template<typename Candidate, typename BaseSelectorType>
+    std::vector<Candidate> CollectCachedObjects(const std::string& selection_label,
+                                                const BaseSelectorType& base_selector,
+                                                const std::vector<Candidate>& all_candidates,
+                                                const SelectionDependencies& dependencies = {})
+    {
+        if(!incrementalSelection)
+            return CollectObjects(selection_label, base_selector, all_candidates);
+
+        auto iter = selectionCache.find(selection_label);
+        if(iter != selectionCache.end() && iter->second.candidates == &all_candidates
+                && iter->second.dependencies == dependencies) {
+            std::vector<Candidate> selected;
+            for(size_t index : iter->second.selected)
+                selected.push_back(all_candidates.at(index));
+            return selected;
+        }
 
+        const auto selected = CollectObjects(selection_label, base_selector, all_candidates);
+        SelectionCacheEntry entry{ &all_candidates, dependencies, {} };
+        for(const auto& candidate : selected) {
+            const auto candidate_iter = std::find_if(all_candidates.begin(), all_candidates.end(),
+                [&](const Candidate& other) { return &(*other) == &(*candidate); });
+            if(candidate_iter == all_candidates.end())
+                throw analysis::exception("Selected candidate not found in the original collection.");
+            entry.selected.push_back(static_cast<size_t>(candidate_iter - all_candidates.begin()));
+        }
+        selectionCache[selection_label] = entry;
         return selected;
     }
 
+    // If the fits are asynchronous, selection.svfitResult is not set: the result is stored directly in the tuple
+    // entry by WritePendingEntries, once the fit is done.
+    template<typename SelectionResults>
+    void RunSVfit(SelectionResults& selection)
+    {
+        using FitProducer = analysis::sv_fit::FitProducer;
+        using FitResultsCache = analysis::sv_fit::FitResultsCache;
+
+        const auto& higgs = *selection.higgs;
+        bool cache_hit;
+        if(asyncFitProducer) {
+            const auto measured_leptons = FitProducer::CreateMeasuredLeptons(higgs);
+            const auto key = FitResultsCache::MakeKey(measured_leptons, met->GetMomentum(), met->GetCovMatrix());
+            cache_hit = asyncSvfitCache.Find(key, currentFits.svfitResult);
+            if(!cache_hit) {
+                currentFits.svfitResult = asyncFitProducer->RunSVfit(measured_leptons, met->GetMomentum(),
+                                                                     met->GetCovMatrix());
+                asyncSvfitCache.Add(key, currentFits.svfitResult);
+            }
+        } else
+            selection.svfitResult = svfitProducer->Fit(higgs, *met, svfitCache, cache_hit);
+        std::ostringstream ss_scale;
+        ss_scale << eventEnergyScale;
+        GetAnaData(GetAnaData().SVfit_cache, ss_scale.str()).Fill(cache_hit);
+    }
+
     template<typename HiggsCandidate>
     static bool HiggsComparitor(const HiggsCandidate& h1, const HiggsCandidate& h2)
     {
@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <cstring>
 #include "DataFormats/PatCandidates/interface/Electron.h"
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/PatCandidates/interface/Tau.h"
@@ -54,6 +55,58 @@ inline svFitStandalone::MeasuredTauLepton CreateMeasuredLepton(const LeptonCandi
 
 } // namespace detail
 
+// Results of the fits performed within the same event. Fit inputs are quantized to single precision, i.e. to the
+// precision with which the momenta are stored in the tuples.
+template<typename Result>
+class BasicFitResultsCache {
+public:
+    using Key = std::vector<uint32_t>;
+
+    static Key MakeKey(const std::vector<svFitStandalone::MeasuredTauLepton>& measured_leptons,
+                       const LorentzVector& met_momentum, const SquareMatrix<2>& met_cov)
+    {
+        Key key;
+        for(const auto& lepton : measured_leptons) {
+            key.push_back(static_cast<uint32_t>(lepton.type()));
+            key.push_back(static_cast<uint32_t>(lepton.decayMode()));
+            for(double value : { lepton.pt(), lepton.eta(), lepton.phi(), lepton.mass() })
+                key.push_back(Quantize(value));
+        }
+        key.push_back(Quantize(met_momentum.Px()));
+        key.push_back(Quantize(met_momentum.Py()));
+        for(unsigned i = 0; i < 2; ++i) {
+            for(unsigned j = 0; j < 2; ++j)
+                key.push_back(Quantize(met_cov(i, j)));
+        }
+        return key;
+    }
+
+    bool Find(const Key& key, Result& result) const
+    {
+        const auto iter = results.find(key);
+        if(iter == results.end()) return false;
+        result = iter->second;
+        return true;
+    }
+
+    void Add(const Key& key, const Result& result) { results[key] = result; }
+    void Clear() { results.clear(); }
+
+private:
+    static uint32_t Quantize(double value)
+    {
+        const float float_value = static_cast<float>(value);
+        uint32_t bits;
+        std::memcpy(&bits, &float_value, sizeof(bits));
+        return bits;
+    }
+
+private:
+    std::map<Key, Result> results;
+};
+
+using FitResultsCache = BasicFitResultsCache<FitResults>;
+
 class FitProducer {
 public:
     explicit FitProducer(const std::string& visPtResolutionFileName, int _verbosity = 0)
@@ -65,12 +118,38 @@ public:
     template<typename FirstLeg, typename SecondLeg, typename MetObject>
     FitResults Fit(const CompositCandidate<FirstLeg, SecondLeg>& higgs, const MissingET<MetObject>& met) const
     {
-        std::vector<svFitStandalone::MeasuredTauLepton> measured_leptons = {
+        return RunAlgorithm(CreateMeasuredLeptons(higgs), met.GetMomentum(), met.GetCovMatrix());
+    }
+
+    FitResults Fit(const std::vector<svFitStandalone::MeasuredTauLepton>& measured_leptons,
+                   const LorentzVector& met_momentum, const SquareMatrix<2>& met_cov) const
+    {
+        return RunAlgorithm(measured_leptons, met_momentum, met_cov);
+    }
+
+    template<typename FirstLeg, typename SecondLeg, typename MetObject>
+    FitResults Fit(const CompositCandidate<FirstLeg, SecondLeg>& higgs, const MissingET<MetObject>& met,
+                   FitResultsCache& cache, bool& cache_hit) const
+    {
+        const auto measured_leptons = CreateMeasuredLeptons(higgs);
+        const auto key = FitResultsCache::MakeKey(measured_leptons, met.GetMomentum(), met.GetCovMatrix());
+        FitResults result;
+        cache_hit = cache.Find(key, result);
+        if(!cache_hit) {
+            result = RunAlgorithm(measured_leptons, met.GetMomentum(), met.GetCovMatrix());
+            cache.Add(key, result);
+        }
+        return result;
+    }
+
+    template<typename FirstLeg, typename SecondLeg>
+    static std::vector<svFitStandalone::MeasuredTauLepton> CreateMeasuredLeptons(
+            const CompositCandidate<FirstLeg, SecondLeg>& higgs)
+    {
+        return {
             detail::CreateMeasuredLepton(higgs.GetFirstDaughter()),
             detail::CreateMeasuredLepton(higgs.GetSecondDaughter())
         };
-
-        return RunAlgorithm(measured_leptons, met.GetMomentum(), met.GetCovMatrix());
     }
 
 private:
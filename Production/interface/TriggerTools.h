@@ -3,6 +3,7 @@ This file is part of https://github.com/hh-italian-group/h-tautau. */
 
 #pragma once
 
+#include <array>
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Common/interface/TriggerNames.h"
 #include "FWCore/Framework/interface/EDConsumerBase.h"
@@ -60,6 +61,22 @@ public:
     template<typename T> using EDGetTokenT = edm::EDGetTokenT<T>;
     template<typename T> using Handle = edm::Handle<T>;
     using TriggerObjectSet = std::set<const pat::TriggerObjectStandAlone*>;
+    using PathDescriptorPair = std::pair<size_t, size_t>;
+    using PathDescriptorMap = std::vector<PathDescriptorPair>;
+    using DescriptorBits = analysis::TriggerResults::Bits;
+    static constexpr size_t MaxNumberOfLegs = 2;
+
+    // Matching between the HLT paths of a trigger menu and the trigger descriptors.
+    struct TriggerMenuInfo {
+        PathDescriptorMap acceptPaths; // HLT path index and the index of the first matching descriptor
+        std::vector<DescriptorBits> pathDescriptors; // all descriptors matched by each HLT path
+    };
+
+    // Trigger object that passes the path and filter requirements of at least one descriptor leg.
+    struct TriggerObjectMatchInfo {
+        const pat::TriggerObjectStandAlone* object;
+        std::array<DescriptorBits, MaxNumberOfLegs> legMatches;
+    };
 
     TriggerTools(EDGetTokenT<edm::TriggerResults>&& _triggerResultsSIM_token,
                  EDGetTokenT<edm::TriggerResults>&& _triggerResultsHLT_token,
@@ -73,7 +90,8 @@ public:
 
     void Initialize(const edm::Event& iEvent);
 
-    void SetTriggerAcceptBits(const analysis::TriggerDescriptors& descriptors, analysis::TriggerResults& results);
+    // Returns true if the HLT paths had to be matched with the descriptors, i.e. a new trigger menu is processed.
+    bool SetTriggerAcceptBits(const analysis::TriggerDescriptors& descriptors, analysis::TriggerResults& results);
 
     TriggerObjectSet FindMatchingTriggerObjects(const analysis::TriggerDescriptors& descriptors, size_t path_index,
             const std::set<trigger::TriggerObjectType>& objectTypes, const LorentzVector& candidateMomentum,
@@ -121,6 +139,14 @@ public:
     bool GetAnyTriggerResult(const std::string& name) const;
 
 private:
+    const TriggerMenuInfo& GetTriggerMenuInfo(const analysis::TriggerDescriptors& descriptors,
+                                              const edm::TriggerNames& triggerNames, bool& is_new);
+    const std::vector<TriggerObjectMatchInfo>& GetTriggerObjectMatchInfos(
+            const analysis::TriggerDescriptors& descriptors);
+
+private:
+    using PathDescriptorKey = std::pair<const analysis::TriggerDescriptors*, edm::ParameterSetID>;
+
     std::map<CMSSW_Process, EDGetTokenT<edm::TriggerResults>> triggerResults_tokens;
     EDGetTokenT<pat::PackedTriggerPrescales> triggerPrescales_token;
     EDGetTokenT<pat::TriggerObjectStandAloneCollection> triggerObjects_token;
@@ -131,6 +157,9 @@ private:
     edm::Handle<pat::PackedTriggerPrescales> triggerPrescales;
     edm::Handle<pat::TriggerObjectStandAloneCollection> triggerObjects;
     edm::Handle<std::vector<l1extra::L1JetParticle>> l1JetParticles;
+    std::map<PathDescriptorKey, TriggerMenuInfo> triggerMenuInfos;
+    const analysis::TriggerDescriptors* matchInfoDescriptors;
+    std::vector<TriggerObjectMatchInfo> triggerObjectMatchInfos;
 };
 
 } // namespace analysis
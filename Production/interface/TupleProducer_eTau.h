@@ -18,7 +18,8 @@ public:
     using HiggsCandidate = SelectionResults::HiggsCandidate;
 
 public:
-    TupleProducer_eTau(const edm::ParameterSet& iConfig) : BaseTupleProducer(iConfig, "eTau") {}
+    TupleProducer_eTau(const edm::ParameterSet& iConfig, const TupleProducerGlobalCache* cache) :
+        BaseTupleProducer(iConfig, "eTau", cache) {}
 
 private:
     virtual void ProcessEvent(Cutter& cut) override;
@@ -10,7 +10,8 @@ public:
     using HiggsCandidate = SelectionResults::HiggsCandidate;
 
 public:
-    TupleProducer_muMu(const edm::ParameterSet& iConfig) : BaseTupleProducer(iConfig, "muMu") {}
+    TupleProducer_muMu(const edm::ParameterSet& iConfig, const TupleProducerGlobalCache* cache) :
+        BaseTupleProducer(iConfig, "muMu", cache) {}
 
 private:
     virtual void ProcessEvent(Cutter& cut) override;
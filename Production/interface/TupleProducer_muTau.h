@@ -18,7 +18,8 @@ public:
     using HiggsCandidate = SelectionResults::HiggsCandidate;
 
 public:
-    TupleProducer_muTau(const edm::ParameterSet& iConfig) : BaseTupleProducer(iConfig, "muTau") {}
+    TupleProducer_muTau(const edm::ParameterSet& iConfig, const TupleProducerGlobalCache* cache) :
+        BaseTupleProducer(iConfig, "muTau", cache) {}
 
 private:
     virtual void ProcessEvent(Cutter& cut) override;
@@ -18,7 +18,8 @@ public:
     using HiggsCandidate = SelectionResults::HiggsCandidate;
 
 public:
-    TupleProducer_tauTau(const edm::ParameterSet& iConfig) : BaseTupleProducer(iConfig, "tauTau") {}
+    TupleProducer_tauTau(const edm::ParameterSet& iConfig, const TupleProducerGlobalCache* cache) :
+        BaseTupleProducer(iConfig, "tauTau", cache) {}
 
 private:
     virtual void ProcessEvent(Cutter& cut) override;
@@ -12,7 +12,7 @@ void TupleProducer_eTau::ProcessEvent(Cutter& cut)
     cut(primaryVertex.isNonnull(), "vertex");
 
     if(applyTriggerMatch) {
-        triggerTools.SetTriggerAcceptBits(triggerDescriptors, selection.triggerResults);
+        SetTriggerAcceptBits(selection.triggerResults);
         cut(selection.triggerResults.AnyAccpet(), "trigger");
     }
 
@@ -50,7 +50,7 @@ void TupleProducer_eTau::ProcessEvent(Cutter& cut)
 
     ApplyBaseSelection(selection, selection.higgs->GetDaughterMomentums());
     if(runSVfit)
-        selection.svfitResult = svfitProducer->Fit(*selection.higgs, *met);
+        RunSVfit(selection);
     FillEventTuple(selection);
     if(eventEnergyScale == analysis::EventEnergyScale::Central)
         previous_selection = SelectionResultsPtr(new SelectionResults(selection));
@@ -95,21 +95,21 @@ std::vector<BaseTupleProducer::ElectronCandidate> TupleProducer_eTau::CollectZel
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_eTau::SelectZElectron, this, _1, _2);
-    return CollectObjects("Zelectrons", base_selector, electrons);
+    return CollectCachedObjects("Zelectrons", base_selector, electrons);
 }
 
 std::vector<BaseTupleProducer::ElectronCandidate> TupleProducer_eTau::CollectSignalElectrons()
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_eTau::SelectSignalElectron, this, _1, _2);
-    return CollectObjects("SignalElectrons", base_selector, electrons);
+    return CollectCachedObjects("SignalElectrons", base_selector, electrons);
 }
 
 std::vector<BaseTupleProducer::TauCandidate> TupleProducer_eTau::CollectSignalTaus()
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_eTau::SelectSignalTau, this, _1, _2);
-    return CollectObjects("SignalTaus", base_selector, taus);
+    return CollectCachedObjects("SignalTaus", base_selector, taus);
 }
 
 void TupleProducer_eTau::SelectZElectron(const ElectronCandidate& electron, Cutter& cut) const
@@ -196,7 +196,7 @@ void TupleProducer_eTau::FillEventTuple(const SelectionResults& selection)
     FillElectronLeg(1, selection.higgs->GetFirstDaughter());
     FillTauLeg(2, selection.higgs->GetSecondDaughter(), store_tauIds);
 
-    eventTuple.Fill();
+    WriteEventTuple();
 }
 
 #include "FWCore/Framework/interface/MakerMacros.h"
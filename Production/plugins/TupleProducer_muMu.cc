@@ -12,7 +12,7 @@ void TupleProducer_muMu::ProcessEvent(Cutter& cut)
     cut(primaryVertex.isNonnull(), "vertex");
 
     if(applyTriggerMatch) {
-        triggerTools.SetTriggerAcceptBits(triggerDescriptors, selection.triggerResults);
+        SetTriggerAcceptBits(selection.triggerResults);
         cut(selection.triggerResults.AnyAccpet(), "trigger");
     }
 
@@ -53,7 +53,7 @@ void TupleProducer_muMu::ProcessEvent(Cutter& cut)
 
     ApplyBaseSelection(selection, selection.higgs->GetDaughterMomentums());
     if(runSVfit)
-        selection.svfitResult = svfitProducer->Fit(*selection.higgs, *met);
+        RunSVfit(selection);
     FillEventTuple(selection);
 
     if(eventEnergyScale == analysis::EventEnergyScale::Central)
@@ -64,7 +64,7 @@ std::vector<BaseTupleProducer::MuonCandidate> TupleProducer_muMu::CollectSignalM
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_muMu::SelectSignalMuon, this, _1, _2);
-    return CollectObjects("SignalMuons", base_selector, muons);
+    return CollectCachedObjects("SignalMuons", base_selector, muons);
 }
 
 void TupleProducer_muMu::SelectSignalMuon(const MuonCandidate& muon, Cutter& cut) const
@@ -102,7 +102,7 @@ void TupleProducer_muMu::FillEventTuple(const SelectionResults& selection)
     FillMuonLeg(1, selection.higgs->GetFirstDaughter());
     FillMuonLeg(2, selection.higgs->GetSecondDaughter());
 
-    eventTuple.Fill();
+    WriteEventTuple();
 }
 
 #include "FWCore/Framework/interface/MakerMacros.h"
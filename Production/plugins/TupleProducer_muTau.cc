@@ -12,7 +12,7 @@ void TupleProducer_muTau::ProcessEvent(Cutter& cut)
     cut(primaryVertex.isNonnull(), "vertex");
 
     if(applyTriggerMatch) {
-        triggerTools.SetTriggerAcceptBits(triggerDescriptors, selection.triggerResults);
+        SetTriggerAcceptBits(selection.triggerResults);
         cut(selection.triggerResults.AnyAccpet(), "trigger");
     }
 
@@ -50,7 +50,7 @@ void TupleProducer_muTau::ProcessEvent(Cutter& cut)
 
     ApplyBaseSelection(selection, selection.higgs->GetDaughterMomentums());
     if(runSVfit)
-        selection.svfitResult = svfitProducer->Fit(*selection.higgs, *met);
+        RunSVfit(selection);
     FillEventTuple(selection);
 
     if(eventEnergyScale == analysis::EventEnergyScale::Central)
@@ -61,21 +61,21 @@ std::vector<BaseTupleProducer::MuonCandidate> TupleProducer_muTau::CollectZmuons
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_muTau::SelectZMuon, this, _1, _2);
-    return CollectObjects("Zmuons", base_selector, muons);
+    return CollectCachedObjects("Zmuons", base_selector, muons);
 }
 
 std::vector<BaseTupleProducer::MuonCandidate> TupleProducer_muTau::CollectSignalMuons()
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_muTau::SelectSignalMuon, this, _1, _2);
-    return CollectObjects("SignalMuons", base_selector, muons);
+    return CollectCachedObjects("SignalMuons", base_selector, muons);
 }
 
 std::vector<BaseTupleProducer::TauCandidate> TupleProducer_muTau::CollectSignalTaus()
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_muTau::SelectSignalTau, this, _1, _2);
-    return CollectObjects("SignalTaus", base_selector, taus);
+    return CollectCachedObjects("SignalTaus", base_selector, taus);
 }
 
 void TupleProducer_muTau::SelectZMuon(const MuonCandidate& muon, Cutter& cut) const
@@ -159,7 +159,7 @@ void TupleProducer_muTau::FillEventTuple(const SelectionResults& selection)
     FillMuonLeg(1, selection.higgs->GetFirstDaughter());
     FillTauLeg(2, selection.higgs->GetSecondDaughter(), store_tauIds);
 
-    eventTuple.Fill();
+    WriteEventTuple();
 }
 
 #include "FWCore/Framework/interface/MakerMacros.h"
@@ -12,7 +12,7 @@ void TupleProducer_tauTau::ProcessEvent(Cutter& cut)
     cut(primaryVertex.isNonnull(), "vertex");
 
     if(applyTriggerMatch) {
-        triggerTools.SetTriggerAcceptBits(triggerDescriptors, selection.triggerResults);
+        SetTriggerAcceptBits(selection.triggerResults);
         cut(selection.triggerResults.AnyAccpet(), "trigger");
     }
 
@@ -44,7 +44,7 @@ void TupleProducer_tauTau::ProcessEvent(Cutter& cut)
 
     ApplyBaseSelection(selection, selection.higgs->GetDaughterMomentums());
     if(runSVfit)
-        selection.svfitResult = svfitProducer->Fit(*selection.higgs, *met);
+        RunSVfit(selection);
     FillEventTuple(selection);
 
     if(eventEnergyScale == analysis::EventEnergyScale::Central)
@@ -55,7 +55,7 @@ std::vector<BaseTupleProducer::TauCandidate> TupleProducer_tauTau::CollectSignal
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&TupleProducer_tauTau::SelectSignalTau, this, _1, _2);
-    return CollectObjects("SignalTaus", base_selector, taus);
+    return CollectCachedObjects("SignalTaus", base_selector, taus);
 }
 
 void TupleProducer_tauTau::SelectSignalTau(const TauCandidate& tau, Cutter& cut) const
@@ -95,7 +95,7 @@ void TupleProducer_tauTau::FillEventTuple(const SelectionResults& selection)
     FillTauLeg(1, selection.higgs->GetFirstDaughter(), store_tauIds_1);
     FillTauLeg(2, selection.higgs->GetSecondDaughter(), store_tauIds_2);
 
-    eventTuple.Fill();
+    WriteEventTuple();
 }
 
 #include "FWCore/Framework/interface/MakerMacros.h"
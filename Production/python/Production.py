@@ -39,6 +39,8 @@ options.register('lumiFile', '', VarParsing.multiplicity.singleton, VarParsing.v
                         "JSON file with lumi mask.")
 options.register('eventList', '', VarParsing.multiplicity.singleton, VarParsing.varType.string,
                         "List of events to process.")
+options.register('incrementalSelection', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
+                        "Reuse object collections and selection results that are not affected by energy scale shifts.")
 options.register('saveGenTopInfo', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
                         "Save generator-level information for top quarks.")
 options.register('saveGenBosonInfo', False, VarParsing.multiplicity.singleton, VarParsing.varType.bool,
@@ -49,6 +51,8 @@ options.register('dumpPython', False, VarParsing.multiplicity.singleton, VarPars
                         "Dump full config into stdout.")
 options.register('numberOfThreads', 1, VarParsing.multiplicity.singleton, VarParsing.varType.int,
                         "Number of threads.")
+options.register('numberOfFitThreads', 0, VarParsing.multiplicity.singleton, VarParsing.varType.int,
+                        "Number of threads to run SVfit and HHKinFit2 asynchronously (0 - run them inline).")
 
 options.parseArguments()
 
@@ -225,6 +229,8 @@ for channel in channels:
         saveGenTopInfo          = cms.bool(options.saveGenTopInfo),
         saveGenBosonInfo        = cms.bool(options.saveGenBosonInfo),
         saveGenJetInfo          = cms.bool(options.saveGenJetInfo),
+        incrementalSelection    = cms.untracked.bool(options.incrementalSelection),
+        numberOfFitThreads      = cms.untracked.uint32(options.numberOfFitThreads),
     ))
     process.tupleProductionSequence += getattr(process, producerName)
 
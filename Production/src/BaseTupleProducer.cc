@@ -1,3 +1,5 @@
+#include <chrono>
+#include <cmath>
 #include "TROOT.h"
 #include "h-tautau/Production/interface/BaseTupleProducer.h"
 #include "h-tautau/McCorrections/include/TauUncertainties.h"
@@ -9,13 +11,30 @@
 
 namespace {
 bool EnableThreadSafety() { ROOT::EnableThreadSafety(); return true; }
+
+// Statistics of the first stream instance are stored in the same directories as for the single-threaded processing.
+std::string GetInstanceSuffix(size_t instance_id)
+{
+    if(!instance_id) return "";
+    std::ostringstream ss;
+    ss << "_stream" << instance_id;
+    return ss.str();
+}
+
+template<typename Future>
+bool IsFutureReady(const Future& future)
+{
+    return !future.valid() || future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
 }
 
 const bool BaseTupleProducer::enableThreadSafety = EnableThreadSafety();
 
-BaseTupleProducer::BaseTupleProducer(const edm::ParameterSet& iConfig, const std::string& _treeName) :
+BaseTupleProducer::BaseTupleProducer(const edm::ParameterSet& iConfig, const std::string& _treeName,
+                                     const TupleProducerGlobalCache* cache) :
     treeName(_treeName),
-    anaData(&edm::Service<TFileService>()->file(), treeName + "_stat"),
+    instanceSuffix(GetInstanceSuffix(cache->RegisterInstance(treeName))),
+    anaData(&edm::Service<TFileService>()->file(), treeName + "_stat" + instanceSuffix),
     electronsMiniAOD_token(mayConsume<std::vector<pat::Electron> >(iConfig.getParameter<edm::InputTag>("electronSrc"))),
     eleTightIdMap_token(consumes<edm::ValueMap<bool> >(iConfig.getParameter<edm::InputTag>("eleTightIdMap"))),
     eleMediumIdMap_token(consumes<edm::ValueMap<bool> >(iConfig.getParameter<edm::InputTag>("eleMediumIdMap"))),
@@ -45,7 +64,7 @@ BaseTupleProducer::BaseTupleProducer(const edm::ParameterSet& iConfig, const std
     saveGenTopInfo(iConfig.getParameter<bool>("saveGenTopInfo")),
     saveGenBosonInfo(iConfig.getParameter<bool>("saveGenBosonInfo")),
     saveGenJetInfo(iConfig.getParameter<bool>("saveGenJetInfo")),
-    eventTuple(treeName, &edm::Service<TFileService>()->file(), false),
+    incrementalSelection(iConfig.getUntrackedParameter<bool>("incrementalSelection", false)),
     triggerTools(mayConsume<edm::TriggerResults>(edm::InputTag("TriggerResults", "", "SIM")),
                  mayConsume<edm::TriggerResults>(edm::InputTag("TriggerResults", "", "HLT")),
                  mayConsume<edm::TriggerResults>(edm::InputTag("TriggerResults", "", "RECO")),
@@ -53,7 +72,8 @@ BaseTupleProducer::BaseTupleProducer(const edm::ParameterSet& iConfig, const std
                  consumes<pat::PackedTriggerPrescales>(iConfig.getParameter<edm::InputTag>("prescales")),
                  consumes<pat::TriggerObjectStandAloneCollection>(iConfig.getParameter<edm::InputTag>("objects")),
                  mayConsume<std::vector<l1extra::L1JetParticle>>(
-                                                    iConfig.getParameter<edm::InputTag>("l1JetParticleProduct")))
+                                                    iConfig.getParameter<edm::InputTag>("l1JetParticleProduct"))),
+    candidateCollectionsInitialized(false), tauShift(0), jetShift(0)
 {
     root_ext::HistogramFactory<TH1D>::LoadConfig(
             edm::FileInPath("h-tautau/Production/data/histograms.cfg").fullPath());
@@ -73,10 +93,11 @@ BaseTupleProducer::BaseTupleProducer(const edm::ParameterSet& iConfig, const std
         triggerDescriptors.Add(pattern, nLegs, filters);
     }
 
-    if(runSVfit)
-        svfitProducer = std::shared_ptr<analysis::sv_fit::FitProducer>(new analysis::sv_fit::FitProducer(
-            edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitVisMassAndPtResolutionPDF.root").fullPath()));
-    if(runKinFit)
+    asyncFitProducer = cache->GetAsyncFitProducer();
+    if(runSVfit && !asyncFitProducer)
+        svfitProducer = std::shared_ptr<analysis::sv_fit::FitProducer>(
+            new analysis::sv_fit::FitProducer(TupleProducerGlobalCache::GetSVfitResolutionFileName()));
+    if(runKinFit && !asyncFitProducer)
         kinfitProducer = std::shared_ptr<analysis::kin_fit::FitProducer>(new analysis::kin_fit::FitProducer());
     if(applyRecoilCorr)
         recoilPFMetCorrector = std::shared_ptr<RecoilCorrector>(new RecoilCorrector(
@@ -89,19 +110,43 @@ void BaseTupleProducer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     primaryVertex = vertices->ptrAt(0);
     for(auto energyScale : eventEnergyScales) {
         InitializeCandidateCollections(energyScale);
+        currentFits = PendingFits();
         try {
-            Cutter cut(&GetAnaData().Selection("events"));
+            Cutter cut(&GetAnaData(GetAnaData().Selection, "events"));
             cut(true, "events");
             ProcessEvent(cut);
         } catch(cuts::cut_failed&){}
 
-        GetAnaData().Selection("events").fill_selection();
+        GetAnaData(GetAnaData().Selection, "events").fill_selection();
     }
+    FlushEventTuple();
 }
 
-void BaseTupleProducer::endJob()
+void BaseTupleProducer::endStream()
 {
-    eventTuple.Write();
+    if(asyncFitProducer)
+        WritePendingEntries(true);
+    FlushEventTuple();
+}
+
+// Entries of an event that still has entries waiting for the fit results are kept in the buffer, so that all entries
+// of the same event are passed to the output tuple together.
+void BaseTupleProducer::FlushEventTuple()
+{
+    const auto isSameEvent = [](const ntuple::Event& e1, const ntuple::Event& e2) {
+        return e1.run == e2.run && e1.lumi == e2.lumi && e1.evt == e2.evt;
+    };
+
+    const auto& events = eventTuple.GetEvents();
+    size_t n_complete = events.size();
+    if(!pendingEntries.empty()) {
+        const ntuple::Event& next = pendingEntries.front().event;
+        while(n_complete > 0 && isSameEvent(events.at(n_complete - 1), next))
+            --n_complete;
+    }
+    if(!n_complete) return;
+    globalCache()->Fill(events.begin(), events.begin() + n_complete);
+    eventTuple.Erase(n_complete);
 }
 
 void BaseTupleProducer::InitializeAODCollections(const edm::Event& iEvent, const edm::EventSetup& iSetup)
@@ -131,6 +176,13 @@ void BaseTupleProducer::InitializeAODCollections(const edm::Event& iEvent, const
 
     iSetup.get<JetCorrectionsRecord>().get("AK5PF", jetCorParColl);
     jecUnc = std::shared_ptr<JetCorrectionUncertainty>(new JetCorrectionUncertainty((*jetCorParColl)["Uncertainty"]));
+
+    candidateCollectionsInitialized = false;
+    jetUncertainties.clear();
+    genMatches.clear();
+    selectionCache.clear();
+    svfitCache.Clear();
+    asyncSvfitCache.Clear();
 }
 
 void BaseTupleProducer::InitializeCandidateCollections(analysis::EventEnergyScale energyScale)
@@ -150,52 +202,74 @@ void BaseTupleProducer::InitializeCandidateCollections(analysis::EventEnergyScal
     };
 
     eventEnergyScale = energyScale;
+    const int tau_shift = tauEnergyScales.count(energyScale) ? tauEnergyScales.at(energyScale) : 0;
+    const int jet_shift = jetEnergyScales.count(energyScale) ? jetEnergyScales.at(energyScale) : 0;
+
+    // In the incremental selection mode, collections that are not affected by the energy scale shift are kept
+    // from the previous pass over the same event.
+    const bool reuse_collections = incrementalSelection && candidateCollectionsInitialized;
+
+    if(!reuse_collections) {
+        electrons.clear();
+        for(size_t n = 0; n < pat_electrons->size(); ++n) {
+            const edm::Ptr<pat::Electron> ele_ptr(pat_electrons, n);
+            electrons.push_back(ElectronCandidate(ele_ptr, Isolation(*ele_ptr)));
+        }
 
-    electrons.clear();
-    for(size_t n = 0; n < pat_electrons->size(); ++n) {
-        const edm::Ptr<pat::Electron> ele_ptr(pat_electrons, n);
-        electrons.push_back(ElectronCandidate(ele_ptr, Isolation(*ele_ptr)));
-    }
+        muons.clear();
+        for(const auto& muon : *pat_muons)
+            muons.push_back(MuonCandidate(muon, Isolation(muon)));
 
-    muons.clear();
-    for(const auto& muon : *pat_muons)
-        muons.push_back(MuonCandidate(muon, Isolation(muon)));
+        fatJets.clear();
+        for(const auto& jet : * pat_fatJets)
+            fatJets.push_back(JetCandidate(jet));
 
+        InvalidateSelectionCache(&electrons);
+        InvalidateSelectionCache(&muons);
+        InvalidateSelectionCache(&fatJets);
+    }
 
-    taus.clear();
-    for(const auto& tau : *pat_taus) {
-        TauCandidate tauCandidate(tau, Isolation(tau));
-        if(tauEnergyScales.count(energyScale)) {
-            const analysis::gen_truth::MatchResult result =
-                    analysis::gen_truth::LeptonGenMatch(tauCandidate.GetMomentum(), *genParticles);
-            if(result.first == analysis::GenMatch::Tau){
-                const int sign = tauEnergyScales.at(energyScale);
-                const double sf = 1.0 + sign * analysis::uncertainties::tau::energyUncertainty;
+    if(!reuse_collections || tau_shift != tauShift) {
+        taus.clear();
+        for(const auto& tau : *pat_taus) {
+            TauCandidate tauCandidate(tau, Isolation(tau));
+            if(tau_shift != 0 && GetGenMatch(tau).first == analysis::GenMatch::Tau) {
+                const double sf = 1.0 + tau_shift * analysis::uncertainties::tau::energyUncertainty;
                 const auto shiftedMomentum = tau.p4() * sf;
                 tauCandidate.SetMomentum(shiftedMomentum);
             }
+            taus.push_back(tauCandidate);
         }
-        taus.push_back(tauCandidate);
+        tauShift = tau_shift;
+        InvalidateSelectionCache(&taus);
     }
 
-    jets.clear();
-    for(const auto& jet : *pat_jets) {
-        JetCandidate jetCandidate(jet);
-        if(jetEnergyScales.count(energyScale)) {
-            jecUnc->setJetEta(jet.eta());
-            jecUnc->setJetPt(jet.pt()); // here you must use the CORRECTED jet pt
-            const double unc = jecUnc->getUncertainty(true);
-            const int sign = jetEnergyScales.at(energyScale);
-            const double sf = (1.0 + (sign * unc));
-            const auto shiftedMomentum = jet.p4() * sf;
-            jetCandidate.SetMomentum(shiftedMomentum);
+    if(!reuse_collections || jet_shift != jetShift) {
+        if(jet_shift != 0 && jetUncertainties.size() != pat_jets->size()) {
+            jetUncertainties.clear();
+            for(const auto& jet : *pat_jets) {
+                jecUnc->setJetEta(jet.eta());
+                jecUnc->setJetPt(jet.pt()); // here you must use the CORRECTED jet pt
+                jetUncertainties.push_back(jecUnc->getUncertainty(true));
+            }
+        }
+
+        jets.clear();
+        for(size_t n = 0; n < pat_jets->size(); ++n) {
+            const pat::Jet& jet = pat_jets->at(n);
+            JetCandidate jetCandidate(jet);
+            if(jet_shift != 0) {
+                const double sf = (1.0 + (jet_shift * jetUncertainties.at(n)));
+                const auto shiftedMomentum = jet.p4() * sf;
+                jetCandidate.SetMomentum(shiftedMomentum);
+            }
+            jets.push_back(jetCandidate);
         }
-        jets.push_back(jetCandidate);
+        jetShift = jet_shift;
+        InvalidateSelectionCache(&jets);
     }
 
-    fatJets.clear();
-    for(const auto& jet : * pat_fatJets)
-        fatJets.push_back(JetCandidate(jet));
+    candidateCollectionsInitialized = true;
 
     met = std::shared_ptr<MET>(new MET((*pfMETs)[0], (*pfMETs)[0].getSignificanceMatrix()));
     if(metUncertantyMap.count(energyScale)) {
@@ -204,6 +278,16 @@ void BaseTupleProducer::InitializeCandidateCollections(analysis::EventEnergyScal
     }
 }
 
+void BaseTupleProducer::InvalidateSelectionCache(const void* candidates)
+{
+    for(auto iter = selectionCache.begin(); iter != selectionCache.end();) {
+        if(iter->second.candidates == candidates)
+            iter = selectionCache.erase(iter);
+        else
+            ++iter;
+    }
+}
+
 double BaseTupleProducer::Isolation(const pat::Electron& electron)
 {
     const double sum_neutral = electron.pfIsolationVariables().sumNeutralHadronEt
@@ -419,7 +503,7 @@ void BaseTupleProducer::FillGenJetInfo()
     }
 }
 
-void BaseTupleProducer::FillLegGenMatch(size_t leg_id, const analysis::LorentzVectorXYZ& p4)
+void BaseTupleProducer::FillLegGenMatch(size_t leg_id, const reco::Candidate& object)
 {
     using namespace analysis;
     static constexpr int default_int_value = ntuple::DefaultFillValue<Int_t>();
@@ -428,7 +512,7 @@ void BaseTupleProducer::FillLegGenMatch(size_t leg_id, const analysis::LorentzVe
     auto& gen_p4 = leg_id == 1 ? eventTuple().gen_p4_1 : eventTuple().gen_p4_2;
 
     if(isMC) {
-        const auto match = gen_truth::LeptonGenMatch(p4, *genParticles);
+        const auto& match = GetGenMatch(object);
         gen_match = static_cast<int>(match.first);
         const auto metched_p4 = match.second ? match.second->p4() : LorentzVectorXYZ();
         gen_p4 = ntuple::LorentzVectorM(metched_p4);
@@ -438,6 +522,14 @@ void BaseTupleProducer::FillLegGenMatch(size_t leg_id, const analysis::LorentzVe
     }
 }
 
+const analysis::gen_truth::MatchResult& BaseTupleProducer::GetGenMatch(const reco::Candidate& object)
+{
+    auto iter = genMatches.find(&object);
+    if(iter == genMatches.end())
+        iter = genMatches.emplace(&object, analysis::gen_truth::LeptonGenMatch(object.p4(), *genParticles)).first;
+    return iter->second;
+}
+
 void BaseTupleProducer::FillTauIds(size_t leg_id, const std::vector<pat::Tau::IdPair>& tauIds)
 {
     using namespace analysis;
@@ -483,8 +575,18 @@ void BaseTupleProducer::FillMetFilters()
     eventTuple().metFilters = filters.FilterResults();
 }
 
+void BaseTupleProducer::SetTriggerAcceptBits(analysis::TriggerResults& results)
+{
+    using clock = std::chrono::high_resolution_clock;
+    const auto start = clock::now();
+    const bool menu_scan = triggerTools.SetTriggerAcceptBits(triggerDescriptors, results);
+    const std::chrono::duration<double, std::micro> time = clock::now() - start;
+    const double log10_time = std::log10(std::max(time.count(), 1e-2));
+    GetAnaData(GetAnaData().TriggerAcceptBits_log10_time, menu_scan ? "menu_scan" : "cached").Fill(log10_time);
+}
+
 void BaseTupleProducer::ApplyBaseSelection(analysis::SelectionResultsBase& selection,
-                        const std::vector<LorentzVector>& signalLeptonMomentums)
+                        const SignalLeptonMomentums& signalLeptonMomentums)
 {
     static constexpr bool RunKinfitForAllPairs = false;
 
@@ -497,6 +599,12 @@ void BaseTupleProducer::ApplyBaseSelection(analysis::SelectionResultsBase& selec
     const auto runKinfit = [&](size_t first, size_t second) {
         const ntuple::JetPair pair(first, second);
         const size_t pair_index = ntuple::CombinationPairToIndex(pair, n_jets);
+        if(asyncFitProducer) {
+            currentFits.kinfitResults[pair_index] = asyncFitProducer->RunKinFit(
+                    signalLeptonMomentums.at(0), signalLeptonMomentums.at(1),
+                    selection.jets.at(pair.first).GetMomentum(), selection.jets.at(pair.second).GetMomentum(), *met);
+            return;
+        }
         const auto& result = kinfitProducer->Fit(signalLeptonMomentums.at(0), signalLeptonMomentums.at(1),
                                                  selection.jets.at(pair.first).GetMomentum(),
                                                  selection.jets.at(pair.second).GetMomentum(), *met);
@@ -520,7 +628,10 @@ std::vector<BaseTupleProducer::ElectronCandidate> BaseTupleProducer::CollectVeto
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&BaseTupleProducer::SelectVetoElectron, this, _1, _2, signalElectrons);
-    return CollectObjects("vetoElectrons", base_selector, electrons);
+    SelectionDependencies dependencies;
+    for(const ElectronCandidate* electron : signalElectrons)
+        dependencies.push_back(&(**electron));
+    return CollectCachedObjects("vetoElectrons", base_selector, electrons, dependencies);
 }
 
 std::vector<BaseTupleProducer::MuonCandidate> BaseTupleProducer::CollectVetoMuons(
@@ -528,11 +639,14 @@ std::vector<BaseTupleProducer::MuonCandidate> BaseTupleProducer::CollectVetoMuon
 {
     using namespace std::placeholders;
     const auto base_selector = std::bind(&BaseTupleProducer::SelectVetoMuon, this, _1, _2, signalMuons);
-    return CollectObjects("vetoMuons", base_selector, muons);
+    SelectionDependencies dependencies;
+    for(const MuonCandidate* muon : signalMuons)
+        dependencies.push_back(&(**muon));
+    return CollectCachedObjects("vetoMuons", base_selector, muons, dependencies);
 }
 
 std::vector<BaseTupleProducer::JetCandidate> BaseTupleProducer::CollectJets(
-        const std::vector<LorentzVector>& signalLeptonMomentums)
+        const SignalLeptonMomentums& signalLeptonMomentums)
 {
     using namespace cuts::btag_2016;
     using namespace std::placeholders;
@@ -611,7 +725,7 @@ void BaseTupleProducer::SelectVetoMuon(const MuonCandidate& muon, Cutter& cut,
 }
 
 void BaseTupleProducer::SelectJet(const JetCandidate& jet, Cutter& cut,
-                                  const std::vector<LorentzVector>& signalLeptonMomentums) const
+                                  const SignalLeptonMomentums& signalLeptonMomentums) const
 {
     using namespace cuts::H_tautau_2016::jetID;
 
@@ -637,7 +751,7 @@ void BaseTupleProducer::FillElectronLeg(size_t leg_id, const ElectronCandidate&
     GET_LEG(dxy) = electron->gsfTrack()->dxy(primaryVertex->position());
     GET_LEG(dz) = electron->gsfTrack()->dz(primaryVertex->position());
     GET_LEG(iso) = electron.GetIsolation();
-    FillLegGenMatch(leg_id, electron->p4());
+    FillLegGenMatch(leg_id, *electron);
 }
 
 void BaseTupleProducer::FillMuonLeg(size_t leg_id, const MuonCandidate& muon)
@@ -647,7 +761,7 @@ void BaseTupleProducer::FillMuonLeg(size_t leg_id, const MuonCandidate& muon)
     GET_LEG(dxy) = muon->muonBestTrack()->dxy(primaryVertex->position());
     GET_LEG(dz) = muon->muonBestTrack()->dz(primaryVertex->position());
     GET_LEG(iso) = muon.GetIsolation();
-    FillLegGenMatch(leg_id, muon->p4());
+    FillLegGenMatch(leg_id, *muon);
 }
 
 void BaseTupleProducer::FillTauLeg(size_t leg_id, const TauCandidate& tau, bool fill_tauIds)
@@ -658,7 +772,7 @@ void BaseTupleProducer::FillTauLeg(size_t leg_id, const TauCandidate& tau, bool
     GET_LEG(dxy) = packedLeadTauCand->dxy();
     GET_LEG(dz) = packedLeadTauCand->dz();
     GET_LEG(iso) = tau.GetIsolation();
-    FillLegGenMatch(leg_id, tau->p4());
+    FillLegGenMatch(leg_id, *tau);
     if(fill_tauIds)
         FillTauIds(leg_id, tau->tauIDs());
 }
@@ -754,3 +868,54 @@ void BaseTupleProducer::FillEventTuple(const analysis::SelectionResultsBase& sel
     eventTuple().trigger_accepts = selection.triggerResults.GetAcceptBits();
     eventTuple().trigger_matches = selection.triggerResults.GetMatchBits();
 }
+
+void BaseTupleProducer::WriteEventTuple()
+{
+    if(!asyncFitProducer) {
+        eventTuple.Fill();
+        return;
+    }
+
+    pendingEntries.push_back(PendingEntry{ eventTuple(), std::move(currentFits) });
+    eventTuple() = ntuple::Event();
+    currentFits = PendingFits();
+    WritePendingEntries(false);
+}
+
+// Entries are written in the order in which they were filled. Without waiting, the writing stops at the first entry
+// with unfinished fits, unless the queue exceeds its maximal size.
+void BaseTupleProducer::WritePendingEntries(bool wait_for_all)
+{
+    static constexpr size_t maxEntriesPerThread = 10;
+
+    while(!pendingEntries.empty()) {
+        PendingEntry& entry = pendingEntries.front();
+        const bool queue_is_full = pendingEntries.size() > maxEntriesPerThread * asyncFitProducer->NumberOfThreads();
+        if(!wait_for_all && !queue_is_full && !entry.fits.IsReady()) break;
+
+        eventTuple() = entry.event;
+        if(entry.fits.svfitResult.valid()) {
+            const auto& svfitResult = entry.fits.svfitResult.get();
+            eventTuple().SVfit_p4 = svfitResult.momentum;
+            eventTuple().SVfit_mt = svfitResult.transverseMass;
+        }
+        for(const auto& result : entry.fits.kinfitResults) {
+            const auto& kinfitResult = result.second.get();
+            eventTuple().kinFit_jetPairId.push_back(result.first);
+            eventTuple().kinFit_m.push_back(kinfitResult.mass);
+            eventTuple().kinFit_chi2.push_back(kinfitResult.chi2);
+            eventTuple().kinFit_convergence.push_back(kinfitResult.convergence);
+        }
+        eventTuple.Fill();
+        pendingEntries.pop_front();
+    }
+}
+
+bool BaseTupleProducer::PendingFits::IsReady() const
+{
+    if(!IsFutureReady(svfitResult)) return false;
+    for(const auto& result : kinfitResults) {
+        if(!IsFutureReady(result.second)) return false;
+    }
+    return true;
+}
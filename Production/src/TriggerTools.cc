@@ -16,7 +16,7 @@ TriggerTools::TriggerTools(EDGetTokenT<edm::TriggerResults>&& _triggerResultsSIM
                            EDGetTokenT<pat::TriggerObjectStandAloneCollection>&& _triggerObjects_token,
                            EDGetTokenT<std::vector<l1extra::L1JetParticle>>&& _l1JetParticles_token) :
     triggerPrescales_token(_triggerPrescales_token), triggerObjects_token(_triggerObjects_token),
-    l1JetParticles_token(_l1JetParticles_token)
+    l1JetParticles_token(_l1JetParticles_token), matchInfoDescriptors(nullptr)
 {
     triggerResults_tokens[CMSSW_Process::SIM] = _triggerResultsSIM_token;
     triggerResults_tokens[CMSSW_Process::HLT] = _triggerResultsHLT_token;
@@ -32,20 +32,93 @@ void TriggerTools::Initialize(const edm::Event &_iEvent)
     iEvent->getByToken(triggerPrescales_token, triggerPrescales);
     iEvent->getByToken(triggerObjects_token, triggerObjects);
     iEvent->getByToken(l1JetParticles_token, l1JetParticles);
+    matchInfoDescriptors = nullptr;
 }
 
-void TriggerTools::SetTriggerAcceptBits(const analysis::TriggerDescriptors& descriptors,
+bool TriggerTools::SetTriggerAcceptBits(const analysis::TriggerDescriptors& descriptors,
                                         analysis::TriggerResults& results)
 {
     const auto& triggerResultsHLT = triggerResultsMap.at(CMSSW_Process::HLT);
     const edm::TriggerNames& triggerNames = iEvent->triggerNames(*triggerResultsHLT);
+    bool is_new;
+    const TriggerMenuInfo& menuInfo = GetTriggerMenuInfo(descriptors, triggerNames, is_new);
 
-    for (size_t i = 0; i < triggerResultsHLT->size(); ++i) {
-        if(triggerPrescales->getPrescaleForIndex(i) != 1) continue;
-        size_t index;
-        if(descriptors.FindPatternMatch(triggerNames.triggerName(i), index))
-            results.SetAccept(index, triggerResultsHLT->accept(i));
+    for(const auto& path : menuInfo.acceptPaths) {
+        if(triggerPrescales->getPrescaleForIndex(path.first) != 1) continue;
+        results.SetAccept(path.second, triggerResultsHLT->accept(path.first));
     }
+    return is_new;
+}
+
+const TriggerTools::TriggerMenuInfo& TriggerTools::GetTriggerMenuInfo(
+        const analysis::TriggerDescriptors& descriptors, const edm::TriggerNames& triggerNames, bool& is_new)
+{
+    const PathDescriptorKey key(&descriptors, triggerNames.parameterSetID());
+    auto iter = triggerMenuInfos.find(key);
+    is_new = iter == triggerMenuInfos.end();
+    if(is_new) {
+        if(descriptors.size() > TriggerResults::MaxNumberOfTriggers)
+            throw exception("Number of trigger descriptors = %1% exceeds the maximal supported number = %2%.")
+                % descriptors.size() % TriggerResults::MaxNumberOfTriggers;
+        TriggerMenuInfo menuInfo;
+        menuInfo.pathDescriptors.resize(triggerNames.size());
+        for(size_t i = 0; i < triggerNames.size(); ++i) {
+            DescriptorBits& path_bits = menuInfo.pathDescriptors.at(i);
+            for(size_t n = 0; n < descriptors.size(); ++n)
+                path_bits[n] = descriptors.PatternMatch(triggerNames.triggerName(i), n);
+            for(size_t n = 0; n < descriptors.size(); ++n) {
+                if(!path_bits[n]) continue;
+                menuInfo.acceptPaths.emplace_back(i, n);
+                break;
+            }
+        }
+        iter = triggerMenuInfos.emplace(key, std::move(menuInfo)).first;
+    }
+    return iter->second;
+}
+
+const std::vector<TriggerTools::TriggerObjectMatchInfo>& TriggerTools::GetTriggerObjectMatchInfos(
+        const analysis::TriggerDescriptors& descriptors)
+{
+    if(matchInfoDescriptors == &descriptors)
+        return triggerObjectMatchInfos;
+
+    const auto& triggerResultsHLT = triggerResultsMap.at(CMSSW_Process::HLT);
+    const edm::TriggerNames& triggerNames = iEvent->triggerNames(*triggerResultsHLT);
+    bool is_new;
+    const TriggerMenuInfo& menuInfo = GetTriggerMenuInfo(descriptors, triggerNames, is_new);
+
+    triggerObjectMatchInfos.clear();
+    for(const pat::TriggerObjectStandAlone& triggerObject : *triggerObjects) {
+        pat::TriggerObjectStandAlone unpackedTriggerObject(triggerObject);
+        unpackedTriggerObject.unpackPathNames(triggerNames);
+        DescriptorBits path_bits;
+        for(const auto& path : unpackedTriggerObject.pathNames(true, true)) {
+            const size_t path_index = triggerNames.triggerIndex(path);
+            if(path_index < menuInfo.pathDescriptors.size())
+                path_bits |= menuInfo.pathDescriptors.at(path_index);
+        }
+        if(path_bits.none()) continue;
+
+        TriggerObjectMatchInfo matchInfo;
+        matchInfo.object = &triggerObject;
+        bool has_match = false;
+        for(size_t n = 0; n < descriptors.size(); ++n) {
+            if(!path_bits[n]) continue;
+            for(size_t leg_id = 1; leg_id <= MaxNumberOfLegs; ++leg_id) {
+                const auto& filters = descriptors.GetFilters(n, leg_id);
+                const bool pass_filters = std::all_of(filters.begin(), filters.end(),
+                    [&](const std::string& filter) { return unpackedTriggerObject.hasFilterLabel(filter); });
+                matchInfo.legMatches.at(leg_id - 1)[n] = pass_filters;
+                has_match = has_match || pass_filters;
+            }
+        }
+        if(has_match)
+            triggerObjectMatchInfos.push_back(matchInfo);
+    }
+
+    matchInfoDescriptors = &descriptors;
+    return triggerObjectMatchInfos;
 }
 
 TriggerTools::TriggerObjectSet TriggerTools::FindMatchingTriggerObjects(
@@ -59,30 +132,18 @@ TriggerTools::TriggerObjectSet TriggerTools::FindMatchingTriggerObjects(
         return false;
     };
 
-    const auto& filters = descriptors.GetFilters(path_index, leg_id);
-    const auto passFilters = [&](const pat::TriggerObjectStandAlone& triggerObject) {
-        for(const auto& filter : filters)
-            if(!triggerObject.hasFilterLabel(filter)) return false;
-        return true;
-    };
+    if(leg_id < 1 || leg_id > MaxNumberOfLegs)
+        throw exception("Invalid leg id = %1%.") % leg_id;
+    if(path_index >= descriptors.size())
+        throw exception("Trigger pattern index is out of range.");
 
     TriggerObjectSet matches;
-    const auto& triggerResultsHLT = triggerResultsMap.at(CMSSW_Process::HLT);
     const double deltaR2 = std::pow(deltaR_Limit, 2);
-    const edm::TriggerNames& triggerNames = iEvent->triggerNames(*triggerResultsHLT);
-    for (const pat::TriggerObjectStandAlone& triggerObject : *triggerObjects) {
-        if(!hasExpectedType(triggerObject)) continue;
-        if(ROOT::Math::VectorUtil::DeltaR2(triggerObject.polarP4(), candidateMomentum) >= deltaR2) continue;
-        pat::TriggerObjectStandAlone unpackedTriggerObject(triggerObject);
-        unpackedTriggerObject.unpackPathNames(triggerNames);
-        if(!passFilters(unpackedTriggerObject)) continue;
-        const auto& paths = unpackedTriggerObject.pathNames(true, true);
-        for(const auto& path : paths) {
-            if(descriptors.PatternMatch(path, path_index)) {
-                matches.insert(&triggerObject);
-                break;
-            }
-        }
+    for(const TriggerObjectMatchInfo& matchInfo : GetTriggerObjectMatchInfos(descriptors)) {
+        if(!matchInfo.legMatches[leg_id - 1][path_index]) continue;
+        if(!hasExpectedType(*matchInfo.object)) continue;
+        if(ROOT::Math::VectorUtil::DeltaR2(matchInfo.object->polarP4(), candidateMomentum) >= deltaR2) continue;
+        matches.insert(matchInfo.object);
     }
 
     return matches;